@@ -0,0 +1,333 @@
+//===- CallGraphCheck.cpp - Equivalence checks of the call graph summaries -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ehminer-callgraph-check tool, which checks the call
+// graph file, the keyword automaton and the action summaries against the plain
+// algorithms of py/analyzer.py on random inputs, and times both.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphIndex.h"
+#include "ActionSummary.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+// The actions, action functions and keywords, copied from get_function_action
+// in py/analyzer.py rather than taken from ActionSummary, so they check it
+static const char* refFunctions[ActionSummary::ACTION_NUM][24] = {
+    {"abort", "exit", "kill", "killpg", "raise", "alarm", "signal", NULL},
+    {"printf", "fprintf", "dprintf", "vprintf", "vfprintf", "vdprintf", "fputs", "puts", "fwrite",
+     "perror", "psignal", "psiginfo", "syslog", "pwrite", "write", "writev", "written", "msgsnd",
+     "send", "sendto", "sendmsg", NULL},
+    {"free", NULL},
+    {"remove", "unlink", "unlinkat", "rmdir", NULL},
+    {"close", "fclose", "pclose", "shutdown", "closelog", NULL},
+    {"return", NULL},
+    {"goto", NULL},
+    {"break", NULL},
+    {"continue", NULL}
+};
+static const char* refKeywords[ActionSummary::ACTION_NUM][48] = {
+    {"abort", "exit", "die", "kill", "quit", "stop", NULL},
+    {"error", "err", "warn", "alert", "assert", "fail", "crit", "emerg", "out", "exit", "die", "halt",
+     "suspend", "wrong", "fatal", "fault", "misplay", "damage", "illegal", "exception", "errmsg", "abort", "msg",
+     "record", "report", "stop", "quit", "close", "put", "print", "write", "log", "message", "dump", "hint",
+     "trace", "notify", NULL},
+    {"free", "clean", "clear", NULL},
+    {"rm", "unlink", "del", "clean", NULL},
+    {"close", "shutdown", NULL},
+    {"return", NULL},
+    {"goto", NULL},
+    {"break", NULL},
+    {"continue", NULL}
+};
+
+// The depth of the breadth-first search of get_function_action
+#define REF_MAX_LEVEL 20
+
+// The pieces of the random names besides the keywords and the action functions,
+// e.g., a keyword split into two pieces
+static const char* namePieces[] = {"_", "x", "2", "Log", "DEL", "ab", "ort", "cl", "ose", "helper", "main_loop"};
+#define NAME_PIECE_NUM (sizeof(namePieces) / sizeof(namePieces[0]))
+
+// Command line options
+static unsigned seed = 1;
+static unsigned graphNum = 300;
+static unsigned nameNum = 200000;
+
+// Get the wall time in seconds
+static double getTime(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// A linear congruential generator, so a seed gives the same inputs everywhere
+static unsigned randomState;
+static unsigned getRandom(unsigned n){
+    randomState = randomState * 1103515245 + 12345;
+    return (randomState >> 16) % n;
+}
+
+// Get a random string of a list ending with NULL
+static const char* getRandomOf(const char** list){
+    unsigned num = 0;
+    while(list[num])
+        num++;
+    return list[getRandom(num)];
+}
+
+// Get a random piece of a name, which may be a keyword or an action function
+static string getRandomPiece(){
+    unsigned action = getRandom(ActionSummary::ACTION_NUM);
+    string piece;
+    switch(getRandom(3)){
+        case 0: piece = getRandomOf(refKeywords[action]); break;
+        case 1: piece = getRandomOf(refFunctions[action]); break;
+        default: return namePieces[getRandom(NAME_PIECE_NUM)];
+    }
+    
+    // The keywords match case-insensitively, and the action functions don't
+    if(getRandom(4) == 0)
+        piece[0] = toupper(piece[0]);
+    return piece;
+}
+
+// Get a random name of up to three pieces
+static string getRandomName(){
+    string name;
+    unsigned pieceNum = getRandom(4);
+    for(unsigned i = 0; i < pieceNum; i++)
+        name += getRandomPiece();
+    return name;
+}
+
+// Classify a name as analyzer.py does, an exact match of each action function
+// and a substring test of each keyword on the lower case name
+static void classifyByReference(const string& name, unsigned& functionMask, unsigned& keywordMask){
+    string lower = name;
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    functionMask = keywordMask = 0;
+    for(unsigned action = 0; action < ActionSummary::ACTION_NUM; action++){
+        for(unsigned i = 0; refFunctions[action][i]; i++)
+            if(name == refFunctions[action][i])
+                functionMask |= 1u << action;
+        for(unsigned i = 0; refKeywords[action][i]; i++)
+            if(lower.find(refKeywords[action][i]) != string::npos)
+                keywordMask |= 1u << action;
+    }
+}
+
+// Get the level of an action taken by a function by the breadth-first search
+// of get_function_action, 0 if it is not taken in REF_MAX_LEVEL levels
+static unsigned getLevelByReference(const CallGraphIndex& graph, unsigned node, unsigned action){
+    set<unsigned> roots;
+    roots.insert(node);
+    for(unsigned level = 1; !roots.empty() && level <= REF_MAX_LEVEL; level++){
+        set<unsigned> nextRoots;
+        for(set<unsigned>::iterator it = roots.begin(); it != roots.end(); ++it){
+            unsigned functionMask, keywordMask;
+            classifyByReference(graph.getName(*it), functionMask, keywordMask);
+            if(functionMask & (1u << action))
+                return level;
+            if(keywordMask & (1u << action))
+                nextRoots.insert(graph.calleeBegin(*it), graph.calleeEnd(*it));
+        }
+        roots.swap(nextRoots);
+    }
+    return 0;
+}
+
+// Check the keyword automaton against the substring tests on random names
+static bool checkAutomaton(){
+    
+    randomState = seed;
+    vector<string> names;
+    for(unsigned i = 0; i < nameNum; i++)
+        names.push_back(getRandomName());
+    
+    double start = getTime();
+    vector<unsigned> refMasks(names.size() * 2);
+    for(unsigned i = 0; i < names.size(); i++)
+        classifyByReference(names[i], refMasks[i * 2], refMasks[i * 2 + 1]);
+    double refTime = getTime() - start;
+    
+    start = getTime();
+    vector<unsigned> masks(names.size() * 2);
+    for(unsigned i = 0; i < names.size(); i++)
+        ActionSummary::classify(names[i].c_str(), masks[i * 2], masks[i * 2 + 1]);
+    double automatonTime = getTime() - start;
+    
+    for(unsigned i = 0; i < names.size(); i++){
+        if(masks[i * 2] != refMasks[i * 2] || masks[i * 2 + 1] != refMasks[i * 2 + 1]){
+            printf("FAIL automaton: \"%s\" functions %x, expected %x, keywords %x, expected %x\n", names[i].c_str(),
+                   masks[i * 2], refMasks[i * 2], masks[i * 2 + 1], refMasks[i * 2 + 1]);
+            return false;
+        }
+    }
+    printf("ok   automaton   %u names, substring tests %.3f s, automaton %.3f s\n", nameNum, refTime, automatonTime);
+    return true;
+}
+
+// Check the action summaries against the breadth-first search on random graphs with cycles
+static bool checkSummary(){
+    
+    randomState = seed;
+    double refTime = 0, summaryTime = 0;
+    for(unsigned t = 0; t < graphNum; t++){
+        
+        // Some functions share a name, defined in different files
+        CallGraphBuilder builder;
+        unsigned nodeNum = 5 + getRandom(40);
+        vector<string> names(nodeNum);
+        for(unsigned i = 0; i < nodeNum; i++)
+            names[i] = getRandom(4) ? getRandomName() + to_string(i) : getRandomOf(refFunctions[getRandom(ActionSummary::ACTION_NUM)]);
+        for(unsigned i = 0; i < nodeNum; i++)
+            builder.addNode(names[i], to_string(i));
+        for(unsigned i = 0; i < nodeNum * 2; i++){
+            unsigned from = getRandom(nodeNum), to = getRandom(nodeNum);
+            builder.addEdge(names[from], to_string(from), names[to], to_string(to));
+        }
+        vector<char> image;
+        CallGraphIndex graph;
+        if(!builder.build(image) || !graph.assign(image)){
+            printf("FAIL summary: can't build graph %u\n", t);
+            return false;
+        }
+        
+        double start = getTime();
+        ActionSummary summary;
+        summary.compute(graph);
+        summaryTime += getTime() - start;
+        
+        for(unsigned node = 0; node < graph.getNodeNum(); node++){
+            for(unsigned action = 0; action < ActionSummary::ACTION_NUM; action++){
+                start = getTime();
+                unsigned level = getLevelByReference(graph, node, action);
+                refTime += getTime() - start;
+                if(summary.getLevel(node, action) != level){
+                    printf("FAIL summary: graph %u, %s@%s %s level %u, expected %u\n", t, graph.getName(node), graph.getDefLoc(node),
+                           ActionSummary::getActionName(action), summary.getLevel(node, action), level);
+                    return false;
+                }
+            }
+        }
+    }
+    printf("ok   summary     %u graphs, breadth-first search %.3f s, summary %.3f s\n", graphNum, refTime, summaryTime);
+    
+    // A cycle longer than REF_MAX_LEVEL, the levels stop at REF_MAX_LEVEL
+    CallGraphBuilder builder;
+    unsigned chainLength = 100000;
+    for(unsigned i = 0; i + 1 < chainLength; i++)
+        builder.addEdge("log_" + to_string(i), "c.c", "log_" + to_string(i + 1), "c.c");
+    builder.addEdge("log_" + to_string(chainLength - 1), "c.c", "printf", "");
+    builder.addEdge("printf", "", "log_0", "c.c");
+    vector<char> image;
+    CallGraphIndex graph;
+    builder.build(image);
+    graph.assign(image);
+    ActionSummary summary;
+    double start = getTime();
+    summary.compute(graph);
+    double chainTime = getTime() - start;
+    
+    // The function log_i is at level chainLength - i + 1 of output
+    unsigned deepest = graph.lookup("log_" + to_string(chainLength - REF_MAX_LEVEL + 1), "c.c");
+    unsigned cut = graph.lookup("log_" + to_string(chainLength - REF_MAX_LEVEL), "c.c");
+    if(summary.getLevel(deepest, ActionSummary::ACTION_OUTPUT) != REF_MAX_LEVEL || summary.getLevel(cut, ActionSummary::ACTION_OUTPUT) != 0){
+        printf("FAIL summary: chain levels %u and %u, expected %u and 0\n",
+               summary.getLevel(deepest, ActionSummary::ACTION_OUTPUT), summary.getLevel(cut, ActionSummary::ACTION_OUTPUT), REF_MAX_LEVEL);
+        return false;
+    }
+    printf("ok   chain       %u functions in a cycle, summary %.3f s\n", chainLength, chainTime);
+    return true;
+}
+
+// Check the queries of the call graph file, loaded by mmap and by read
+static bool checkIndex(){
+    
+    CallGraphBuilder builder;
+    builder.addEdge("main", "a.c", "foo", "a.c");
+    builder.addEdge("main", "a.c", "bar", "b.c");
+    builder.addEdge("foo", "a.c", "exit", "stdlib.h");
+    builder.addEdge("foo", "a.c", "foo", "a.c");
+    builder.addEdge("foo", "a.c", "foo", "a.c");
+    builder.addEdge("bar", "b.c", "log_err", "b.c");
+    builder.addEdge("bar", "c.c", "x", "c.c");
+    builder.addEdge("log_err", "b.c", "fprintf", "stdio.h");
+    
+    char file[] = "/tmp/ehminer-callgraph-XXXXXX";
+    int fd = mkstemp(file);
+    if(fd < 0){
+        printf("FAIL index: can't create a temporary file\n");
+        return false;
+    }
+    close(fd);
+    
+    bool ok = builder.write(file);
+    for(int useMmap = 0; ok && useMmap < 2; useMmap++){
+        CallGraphIndex graph;
+        ok = graph.load(file, useMmap);
+        unsigned mainNode = graph.lookup("main", "a.c");
+        unsigned fprintfNode = graph.lookup("fprintf", "stdio.h");
+        pair<unsigned, unsigned> bars = graph.lookupName("bar");
+        vector<unsigned> chain = graph.getCallChain(mainNode, fprintfNode);
+        
+        ok = ok && graph.getNodeNum() == 8 && graph.getEdgeNum() == 7 &&
+             mainNode != CallGraphIndex::NONE && fprintfNode != CallGraphIndex::NONE &&
+             graph.lookup("main", "b.c") == CallGraphIndex::NONE && bars.second - bars.first == 2 &&
+             graph.isReachable(mainNode, fprintfNode) && !graph.isReachable(mainNode, fprintfNode, 2) &&
+             graph.isReachable(mainNode, fprintfNode, 3) && !graph.isReachable(fprintfNode, mainNode) &&
+             chain.size() == 4 && !strcmp(graph.getName(chain[1]), "bar") && !strcmp(graph.getName(chain[2]), "log_err");
+    }
+    
+    // A truncated file is rejected
+    FILE* output = fopen(file, "wb");
+    fwrite("EHCSR01", 1, 8, output);
+    fclose(output);
+    CallGraphIndex graph;
+    ok = ok && !graph.load(file);
+    unlink(file);
+    
+    printf("%s index\n", ok ? "ok  " : "FAIL");
+    return ok;
+}
+
+int main(int argc, const char** argv){
+    
+    for(int i = 1; i < argc; i++){
+        if(!strncmp(argv[i], "-seed=", 6))
+            seed = atoi(argv[i] + 6);
+        else if(!strncmp(argv[i], "-graphs=", 8))
+            graphNum = atoi(argv[i] + 8);
+        else if(!strncmp(argv[i], "-names=", 7))
+            nameNum = atoi(argv[i] + 7);
+        else{
+            printf("Usage: ehminer-callgraph-check [-seed=<number>] [-graphs=<number>] [-names=<number>]\n");
+            return strcmp(argv[i], "-help") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+    
+    bool ok = checkIndex();
+    ok = checkAutomaton() && ok;
+    ok = checkSummary() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
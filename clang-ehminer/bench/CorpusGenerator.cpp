@@ -0,0 +1,179 @@
+//===------ CorpusGenerator.cpp - Generated C code for the benchmarks ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a generator of C functions with error-handling code.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CorpusGenerator.h"
+
+#include <cstdio>
+
+#define API_NUM 16
+#define ALLOC_NUM 4
+
+// Get a pseudo random number in [0, n), a linear congruential generator
+unsigned CorpusGenerator::random(unsigned n){
+    state = state * 1103515245 + 12345;
+    return (state >> 16) % n;
+}
+
+// Generate a condition with the given number of sub-conditions
+string CorpusGenerator::generateCondition(unsigned complexity){
+    static const char* atoms[] = {
+        "ret < 0", "ret == -1", "ret != 0", "err != 0", "!p", "p == 0",
+        "c->state > 3", "(ret & 4) == 0", "c->buf[n] == 'x'", "(ret > 0 ? err : 1)"
+    };
+    unsigned atomNum = sizeof(atoms) / sizeof(char*);
+    
+    string cond;
+    for(unsigned i = 0; i < complexity; i++){
+        if(i != 0)
+            cond += random(2) ? " && " : " || ";
+        
+        // A call in the condition is checked directly, e.g., if(api_1(n, &err) == 0)
+        if(random(8) == 0){
+            char call[64];
+            sprintf(call, "api_%u(n, &err) == 0", random(API_NUM));
+            cond += call;
+        }
+        else
+            cond += atoms[random(atomNum)];
+    }
+    if(cond.empty())
+        cond = "ret";
+    return cond;
+}
+
+// Generate the error handling code of a branch
+string CorpusGenerator::generateHandler(unsigned indent){
+    string space(indent, ' ');
+    string code;
+    char line[128];
+    
+    sprintf(line, "%slog_error(\"error %u: %%d\", ret);\n", space.c_str(), random(1000));
+    code += line;
+    switch(random(3)){
+        case 0:
+            code += space + "return -1;\n";
+            break;
+        case 1:
+            code += space + "goto out;\n";
+            break;
+        default:
+            code += space + "ret = -1;\n";
+    }
+    return code;
+}
+
+// Generate the calls and checks of a block, nested checks are generated until depth is 0
+void CorpusGenerator::generateBlock(unsigned depth, unsigned indent, string& code){
+    string space(indent, ' ');
+    char line[128];
+    
+    for(unsigned i = 0; i < options.callDensity; i++){
+        unsigned kind = random(10);
+        
+        // Check a pointer, e.g., p = alloc_1(n); if(!p)
+        if(kind == 0){
+            sprintf(line, "%sp = alloc_%u(n);\n", space.c_str(), random(ALLOC_NUM));
+            code += line;
+            code += space + "if(!p){\n";
+            code += generateHandler(indent + 4);
+            code += space + "}\n";
+            continue;
+        }
+        
+        // Check in a loop, e.g., for(...){ ret = api_1(i, &err); if(ret) break; }
+        if(kind == 1 && depth > 0){
+            code += space + "for(i = 0; i < n; i++){\n";
+            sprintf(line, "%s    ret = api_%u(i, &err);\n", space.c_str(), random(API_NUM));
+            code += line;
+            code += space + "    if(" + generateCondition(options.condComplexity) + "){\n";
+            code += space + "        log_warn(\"retry %d\", i);\n";
+            code += space + (random(2) ? "        continue;\n" : "        break;\n");
+            code += space + "    }\n";
+            code += space + "}\n";
+            continue;
+        }
+        
+        sprintf(line, "%sret = api_%u(n + %u, &err);\n", space.c_str(), random(API_NUM), i);
+        code += line;
+        
+        // Check the result by switch
+        if(kind == 2){
+            code += space + "switch(ret){\n";
+            code += space + "    case 0:\n";
+            code += space + "        break;\n";
+            code += space + "    case -1:\n";
+            code += generateHandler(indent + 8);
+            code += space + "        break;\n";
+            code += space + "    default:\n";
+            code += space + "        log_warn(\"unknown %d\", ret);\n";
+            code += space + "        break;\n";
+            code += space + "}\n";
+            continue;
+        }
+        
+        // Check the result by if, with nested checks before the handler
+        code += space + "if(" + generateCondition(options.condComplexity) + "){\n";
+        if(depth > 0)
+            generateBlock(depth - 1, indent + 4, code);
+        code += generateHandler(indent + 4);
+        code += space + "}\n";
+        if(random(3) == 0){
+            code += space + "else{\n";
+            code += space + "    log_warn(\"ok %d\", ret);\n";
+            code += space + "}\n";
+        }
+    }
+}
+
+// Generate a function numbered index
+void CorpusGenerator::generateFunction(unsigned index, string& code){
+    char line[128];
+    
+    sprintf(line, "int func_%u(struct ctx *c, int n){\n", index);
+    code += line;
+    code += "    int ret = 0;\n";
+    code += "    int err = 0;\n";
+    code += "    char *p = 0;\n";
+    code += "    int i;\n";
+    generateBlock(options.depth, 4, code);
+    code += "out:\n";
+    code += "    cleanup(c);\n";
+    code += "    return ret;\n";
+    code += "}\n\n";
+}
+
+// Generate the source code of a translation unit
+string CorpusGenerator::generate(){
+    state = options.seed;
+    
+    string code;
+    char line[128];
+    
+    code += "struct ctx { int state; char *buf; };\n";
+    for(unsigned i = 0; i < API_NUM; i++){
+        sprintf(line, "int api_%u(int n, int *err);\n", i);
+        code += line;
+    }
+    for(unsigned i = 0; i < ALLOC_NUM; i++){
+        sprintf(line, "char *alloc_%u(int n);\n", i);
+        code += line;
+    }
+    code += "void log_error(const char *fmt, ...);\n";
+    code += "void log_warn(const char *fmt, ...);\n";
+    code += "void cleanup(struct ctx *c);\n\n";
+    
+    for(unsigned i = 0; i < options.functionNum; i++)
+        generateFunction(i, code);
+    return code;
+}
@@ -0,0 +1,78 @@
+//===- CorpusGenerator.h - Generated C code for the benchmarks -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a generator of C functions with error-handling code.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CorpusGenerator_h
+#define CorpusGenerator_h
+
+#include <string>
+
+using namespace std;
+
+//===----------------------------------------------------------------------===//
+//
+//                     CorpusGenerator Class
+//
+//===----------------------------------------------------------------------===//
+// The generated functions call APIs, check the results in if and switch
+// statements, and log, return, break or goto in the branches, e.g.,
+//
+//      ret = api_3(n, &err);
+//      if(ret < 0 && err != 0){
+//          log_error("error 3: %d", ret);
+//          return -1;
+//      }
+//
+// The code is the same for the same options, so the benchmarks are comparable.
+//===----------------------------------------------------------------------===//
+class CorpusGenerator{
+public:
+    struct Options{
+        // The number of generated functions
+        unsigned functionNum;
+        // The nesting depth of the checks
+        unsigned depth;
+        // The number of calls in each block
+        unsigned callDensity;
+        // The number of sub-conditions in each condition
+        unsigned condComplexity;
+        // The seed of the pseudo random numbers
+        unsigned seed;
+    };
+    
+    explicit CorpusGenerator(const Options& options) : options(options), state(options.seed){}
+    
+    // Generate the source code of a translation unit
+    string generate();
+
+private:
+    // Generate a function numbered index
+    void generateFunction(unsigned index, string& code);
+    
+    // Generate the calls and checks of a block, nested checks are generated until depth is 0
+    void generateBlock(unsigned depth, unsigned indent, string& code);
+    
+    // Generate a condition with the given number of sub-conditions
+    string generateCondition(unsigned complexity);
+    
+    // Generate the error handling code of a branch
+    string generateHandler(unsigned indent);
+    
+    // Get a pseudo random number in [0, n)
+    unsigned random(unsigned n);
+    
+    Options options;
+    unsigned state;
+};
+
+#endif /* CorpusGenerator_h */
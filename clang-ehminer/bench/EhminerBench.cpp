@@ -0,0 +1,517 @@
+//===- EhminerBench.cpp - Micro-benchmarks of the EH-Miner hot paths -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ehminer-bench tool, which times the hot paths of
+// the analysis in isolation on a generated corpus of C functions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "clang/Tooling/Tooling.h"
+
+#include "FindBranchCall.h"
+#include "DataUtility.h"
+#include "CorpusGenerator.h"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <ctime>
+
+using namespace clang::tooling;
+using namespace clang;
+using namespace llvm;
+using namespace std;
+
+// The corpus is parsed as a virtual file under domain "bench" and project "corpus"
+#define CORPUS_FILE "/bench/corpus/corpus.c"
+#define CORPUS_DOMAIN "bench"
+#define CORPUS_PROJECT "corpus"
+
+// Deal with command line options
+static cl::OptionCategory BenchCategory("ehminer-bench options");
+
+static cl::opt<unsigned> FunctionNum("functions",
+                                     cl::desc("Specify the number of generated functions (default is 100)."),
+                                     cl::init(100),
+                                     cl::cat(BenchCategory));
+
+static cl::opt<unsigned> Depth("depth",
+                               cl::desc("Specify the nesting depth of the checks (default is 2)."),
+                               cl::init(2),
+                               cl::cat(BenchCategory));
+
+static cl::opt<unsigned> CallDensity("calls",
+                                     cl::desc("Specify the number of calls in each block (default is 3)."),
+                                     cl::init(3),
+                                     cl::cat(BenchCategory));
+
+static cl::opt<unsigned> CondComplexity("cond",
+                                        cl::desc("Specify the number of sub-conditions in each condition (default is 2)."),
+                                        cl::init(2),
+                                        cl::cat(BenchCategory));
+
+static cl::opt<unsigned> Seed("seed",
+                              cl::desc("Specify the seed of the generated corpus (default is 1)."),
+                              cl::init(1),
+                              cl::cat(BenchCategory));
+
+static cl::opt<unsigned> Iterations("iterations",
+                                    cl::desc("Specify the number of passes over the corpus in each benchmark (default is 10)."),
+                                    cl::init(10),
+                                    cl::cat(BenchCategory));
+
+static cl::opt<string> DatabaseFile("database-file",
+                                    cl::desc("Specify the database of the CallData benchmarks (default is in memory)."),
+                                    cl::init(":memory:"),
+                                    cl::cat(BenchCategory));
+
+static cl::opt<bool> DumpCorpus("dump-corpus",
+                                cl::desc("Print the generated corpus and exit."),
+                                cl::cat(BenchCategory));
+
+// Get the wall time in seconds
+static double getTime(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Keep the results of the benchmarks alive, so the work is not optimized away
+static volatile size_t benchSink;
+
+//===----------------------------------------------------------------------===//
+//
+//                     BenchCollector Class
+//
+//===----------------------------------------------------------------------===//
+// This class collects the functions, branch conditions and calls of the corpus,
+// and pairs each if statement with the call before it and the log call in it.
+//===----------------------------------------------------------------------===//
+class BenchCollector : public RecursiveASTVisitor<BenchCollector>{
+public:
+    // A check of a call result, as recordBranchCall takes it
+    struct Check{
+        FunctionDecl* function;
+        Expr* cond;
+        CallExpr* callExpr;
+        CallExpr* logExpr;
+    };
+    
+    bool VisitFunctionDecl(FunctionDecl* functionDecl){
+        if(functionDecl->isThisDeclarationADefinition() && functionDecl->hasBody()){
+            functions.push_back(functionDecl);
+            lastCall = nullptr;
+        }
+        return true;
+    }
+    
+    bool VisitIfStmt(IfStmt* ifStmt){
+        conds.push_back(ifStmt->getCond());
+        
+        // The stmts are visited in pre-order, so lastCall is the call before the if
+        CallExpr* logExpr = findLogCall(ifStmt->getThen());
+        if(lastCall && logExpr && !functions.empty()){
+            Check check = {functions.back(), ifStmt->getCond(), lastCall, logExpr};
+            checks.push_back(check);
+        }
+        return true;
+    }
+    
+    bool VisitSwitchStmt(SwitchStmt* switchStmt){
+        conds.push_back(switchStmt->getCond());
+        return true;
+    }
+    
+    bool VisitCallExpr(CallExpr* callExpr){
+        FunctionDecl* callee = callExpr->getDirectCallee();
+        if(!callee)
+            return true;
+        calls.push_back(callExpr);
+        if(callee->getNameAsString().compare(0, 4, "api_") == 0 || callee->getNameAsString().compare(0, 6, "alloc_") == 0)
+            lastCall = callExpr;
+        return true;
+    }
+    
+    vector<FunctionDecl*> functions;
+    vector<Expr*> conds;
+    vector<CallExpr*> calls;
+    vector<Check> checks;
+
+private:
+    // Find the first log call in given stmt
+    CallExpr* findLogCall(Stmt* stmt){
+        if(!stmt)
+            return nullptr;
+        if(auto *callExpr = dyn_cast<CallExpr>(stmt)){
+            if(callExpr->getDirectCallee() && callExpr->getDirectCallee()->getNameAsString().compare(0, 4, "log_") == 0)
+                return callExpr;
+        }
+        for(Stmt::child_iterator it = stmt->child_begin(); it != stmt->child_end(); ++it)
+            if(CallExpr* logExpr = findLogCall(*it))
+                return logExpr;
+        return nullptr;
+    }
+    
+    CallExpr* lastCall = nullptr;
+};
+
+//===----------------------------------------------------------------------===//
+//
+//                     EhminerBench Class
+//
+//===----------------------------------------------------------------------===//
+// This class runs the benchmarks. It is a friend of FindBranchCallVisitor and
+// CallData when EHMINER_BENCH is defined, which only this target does, so each
+// private hot path is called directly with the state set up by hand, instead of
+// through the AST traversal. The benchmarks on the AST run
+// while the AST of the corpus is alive, and keep the rows for the CallData
+// benchmarks, which run afterwards on the database.
+//===----------------------------------------------------------------------===//
+class EhminerBench{
+public:
+    // Run the benchmarks of the visitor on the AST of the corpus
+    static void runASTBenchmarks(CompilerInstance* CI, ASTContext& context, StringRef inFile);
+    
+    // Run the benchmarks of the domain lookup and the database writes
+    static void runDataBenchmarks();
+    
+    // Print the header of the report
+    static void printHeader();
+
+private:
+    // Print the result of a benchmark
+    static void report(string name, unsigned long long ops, double seconds);
+    
+    // A call, and the function calling it, as the add* functions take them
+    struct CallRow{
+        string callName;
+        string callLoc;
+        string callDef;
+        string callStr;
+        string funcName;
+        string funcDef;
+    };
+    
+    // The rows collected from the corpus
+    static vector<CallRow> callRows;
+    static vector<BranchInfo> branchInfos;
+};
+
+vector<EhminerBench::CallRow> EhminerBench::callRows;
+vector<BranchInfo> EhminerBench::branchInfos;
+
+// Print the header of the report
+void EhminerBench::printHeader(){
+    printf("%-36s %12s %12s %12s\n", "benchmark", "ops", "total(ms)", "ns/op");
+}
+
+// Print the result of a benchmark
+void EhminerBench::report(string name, unsigned long long ops, double seconds){
+    printf("%-36s %12llu %12.3f %12.1f\n", name.c_str(), ops, seconds * 1e3, ops ? seconds * 1e9 / ops : 0.0);
+    fflush(stdout);
+}
+
+// Run the benchmarks of the visitor on the AST of the corpus
+void EhminerBench::runASTBenchmarks(CompilerInstance* CI, ASTContext& context, StringRef inFile){
+    
+    BenchCollector collector;
+    collector.TraverseDecl(context.getTranslationUnitDecl());
+    fprintf(stderr, "Corpus: %lu functions, %lu conditions, %lu calls, %lu checks\n",
+            collector.functions.size(), collector.conds.size(), collector.calls.size(), collector.checks.size());
+    
+    FindBranchCallVisitor visitor(CI, inFile);
+    double start;
+    unsigned long long ops;
+    
+    // getExprNodeVec, encode each branch condition
+    vector<string> exprNodeVec;
+    ops = 0;
+    start = getTime();
+    for(unsigned i = 0; i < Iterations; i++){
+        for(unsigned j = 0; j < collector.conds.size(); j++){
+            exprNodeVec.clear();
+            visitor.getExprNodeVec(collector.conds[j], exprNodeVec);
+            benchSink += exprNodeVec.size();
+            ops++;
+        }
+    }
+    report("getExprNodeVec", ops, getTime() - start);
+    
+    // getSourceCode, print each condition and call, by pretty-printing and by spelling
+    for(unsigned raw = 0; raw < 2; raw++){
+        FindBranchCallVisitor::setRawSourceText(raw);
+        ops = 0;
+        start = getTime();
+        for(unsigned i = 0; i < Iterations; i++){
+            for(unsigned j = 0; j < collector.conds.size(); j++){
+                benchSink += visitor.getSourceCode(collector.conds[j]).size();
+                ops++;
+            }
+            for(unsigned j = 0; j < collector.calls.size(); j++){
+                benchSink += visitor.getSourceCode(collector.calls[j]).size();
+                ops++;
+            }
+        }
+        report(raw ? "getSourceCode (raw-source-text)" : "getSourceCode (pretty-print)", ops, getTime() - start);
+    }
+    FindBranchCallVisitor::setRawSourceText(false);
+    
+    // recordBranchCall, the rows go to a journal on /dev/null, so SQLite is not timed
+    CallData callData;
+    if(callData.startJournal("/dev/null")){
+        ops = 0;
+        start = getTime();
+        for(unsigned i = 0; i < Iterations; i++){
+            for(unsigned j = 0; j < collector.checks.size(); j++){
+                const BenchCollector::Check& check = collector.checks[j];
+                visitor.FD = check.function;
+                visitor.root = check.function->getBody();
+                visitor.mParentMap.reset();
+                visitor.mExprNodeCache.clear();
+                visitor.mBranchCondVec.assign(1, check.cond);
+                visitor.mPathNumberVec.assign(1, 0);
+                visitor.mSwitchCaseVec.assign(1, nullptr);
+                visitor.mReturnNameVec.assign(1, "ret");
+                visitor.recordBranchCall(check.callExpr, check.logExpr, nullptr, nullptr);
+                ops++;
+            }
+        }
+        report("recordBranchCall", ops, getTime() - start);
+        callData.stopJournal();
+    }
+    
+    // Keep the rows for the CallData benchmarks
+    for(unsigned j = 0; j < collector.checks.size(); j++){
+        const BenchCollector::Check& check = collector.checks[j];
+        FunctionDecl* callDecl = check.callExpr->getDirectCallee();
+        FunctionDecl* logDecl = check.logExpr->getDirectCallee();
+        
+        BranchInfo branchInfo;
+        branchInfo.callName = callDecl->getNameAsString();
+        branchInfo.callDefLoc = visitor.getFileFullPath(context.getFullLoc(callDecl->getLocStart()).getSpellingLoc());
+        branchInfo.callID = visitor.getLocFullPath(context.getFullLoc(check.callExpr->getLocStart()).getExpansionLoc());
+        branchInfo.callStr = visitor.getSourceCode(check.callExpr);
+        branchInfo.callReturnVec.push_back("ret");
+        for(unsigned i = 0; i < check.callExpr->getNumArgs(); i++)
+            branchInfo.callArgVec.push_back(visitor.getSourceCode(check.callExpr->getArg(i)));
+        visitor.getExprNodeVec(check.cond, branchInfo.exprNodeVec);
+        branchInfo.exprStrVec.push_back(visitor.getSourceCode(check.cond));
+        branchInfo.caseLabelVec.push_back("-");
+        branchInfo.pathNumberVec.push_back(0);
+        branchInfo.logName = logDecl->getNameAsString();
+        branchInfo.logDefLoc = visitor.getFileFullPath(context.getFullLoc(logDecl->getLocStart()).getSpellingLoc());
+        branchInfo.logID = visitor.getLocFullPath(context.getFullLoc(check.logExpr->getLocStart()).getExpansionLoc());
+        branchInfo.logStr = visitor.getSourceCode(check.logExpr);
+        for(unsigned i = 0; i < check.logExpr->getNumArgs(); i++)
+            branchInfo.logArgVec.push_back(visitor.getSourceCode(check.logExpr->getArg(i)));
+        branchInfo.logRetType = logDecl->getReturnType().getAsString();
+        for(unsigned i = 0; i < logDecl->getNumParams(); i++)
+            branchInfo.logArgTypeVec.push_back(logDecl->getParamDecl(i)->getType().getAsString());
+        branchInfos.push_back(branchInfo);
+    }
+    
+    // The function of each call, the calls are collected in the order of the functions
+    unsigned functionIndex = 0;
+    for(unsigned j = 0; j < collector.calls.size(); j++){
+        CallExpr* callExpr = collector.calls[j];
+        while(functionIndex + 1 < collector.functions.size() &&
+              collector.functions[functionIndex + 1]->getLocStart() < callExpr->getLocStart())
+            functionIndex++;
+        if(collector.functions.empty())
+            break;
+        FunctionDecl* funcDecl = collector.functions[functionIndex];
+        FunctionDecl* callDecl = callExpr->getDirectCallee();
+        
+        CallRow callRow;
+        callRow.callName = callDecl->getNameAsString();
+        callRow.callLoc = visitor.getLocFullPath(context.getFullLoc(callExpr->getLocStart()).getExpansionLoc());
+        callRow.callDef = visitor.getFileFullPath(context.getFullLoc(callDecl->getLocStart()).getSpellingLoc());
+        callRow.callStr = visitor.getSourceCode(callExpr);
+        callRow.funcName = funcDecl->getNameAsString();
+        callRow.funcDef = visitor.getFileFullPath(context.getFullLoc(funcDecl->getLocStart()).getSpellingLoc());
+        callRows.push_back(callRow);
+    }
+}
+
+// Run the benchmarks of the domain lookup and the database writes
+void EhminerBench::runDataBenchmarks(){
+    
+    CallData callData;
+    double start;
+    unsigned long long ops;
+    
+    // getDomainProjectName, the locations of a file share one cached match
+    ops = 0;
+    start = getTime();
+    for(unsigned i = 0; i < Iterations; i++){
+        for(unsigned j = 0; j < callRows.size(); j++){
+            benchSink += callData.getDomainProjectName(callRows[j].callLoc).first.size();
+            ops++;
+        }
+    }
+    report("getDomainProjectName (cached)", ops, getTime() - start);
+    
+    // getDomainProjectName, a distinct file each time, so each path is matched
+    vector<string> paths;
+    for(unsigned j = 0; j < callRows.size() * Iterations; j++){
+        char path[128];
+        sprintf(path, "/src/%s/%s/dir%u/file%u.c:%u:5", CORPUS_DOMAIN, CORPUS_PROJECT, j % 64, j, j % 1000);
+        paths.push_back(path);
+    }
+    start = getTime();
+    for(unsigned j = 0; j < paths.size(); j++)
+        benchSink += callData.getDomainProjectName(paths[j]).first.size();
+    report("getDomainProjectName (uncached)", paths.size(), getTime() - start);
+    
+    // Each add* path, the rows are bound and inserted by the prepared statements
+    callData.openDatabase(DatabaseFile);
+    
+    ops = 0;
+    start = getTime();
+    for(unsigned i = 0; i < Iterations; i++){
+        for(unsigned j = 0; j < branchInfos.size(); j++){
+            callData.addBranchCall(branchInfos[j]);
+            ops++;
+        }
+    }
+    report("CallData::addBranchCall", ops, getTime() - start);
+    
+    ops = 0;
+    start = getTime();
+    for(unsigned i = 0; i < Iterations; i++){
+        for(unsigned j = 0; j < callRows.size(); j++){
+            const CallRow& row = callRows[j];
+            callData.addFunctionCall(row.callName, row.callLoc, row.callDef, row.callStr);
+            ops++;
+        }
+    }
+    report("CallData::addFunctionCall", ops, getTime() - start);
+    
+    ops = 0;
+    start = getTime();
+    for(unsigned i = 0; i < Iterations; i++){
+        for(unsigned j = 0; j < callRows.size(); j++){
+            const CallRow& row = callRows[j];
+            callData.addCallGraph(row.funcName, row.funcDef, row.callName, row.callDef, row.callLoc, 1);
+            ops++;
+        }
+    }
+    report("CallData::addCallGraph", ops, getTime() - start);
+    
+    ops = 0;
+    start = getTime();
+    for(unsigned i = 0; i < Iterations; i++){
+        for(unsigned j = 0; j < branchInfos.size(); j++){
+            const BranchInfo& info = branchInfos[j];
+            callData.addPrebranchCall(info.callName, info.callID, info.callDefLoc, info.logName, info.logDefLoc);
+            ops++;
+        }
+    }
+    report("CallData::addPrebranchCall", ops, getTime() - start);
+    
+    ops = 0;
+    start = getTime();
+    for(unsigned i = 0; i < Iterations; i++){
+        for(unsigned j = 0; j < branchInfos.size(); j++){
+            const BranchInfo& info = branchInfos[j];
+            callData.addPostbranchCall(info.callName, info.callID, info.callDefLoc, info.logName, info.logDefLoc);
+            ops++;
+        }
+    }
+    report("CallData::addPostbranchCall", ops, getTime() - start);
+    
+    // The counters aggregated by the add* functions are written here
+    start = getTime();
+    callData.flushCounters(true);
+    report("CallData::flushCounters", 1, getTime() - start);
+    
+    start = getTime();
+    callData.closeDatabase();
+    report("CallData::closeDatabase", 1, getTime() - start);
+}
+
+//===----------------------------------------------------------------------===//
+//
+//                     BenchAction Class
+//
+//===----------------------------------------------------------------------===//
+// The frontend action running the benchmarks on the AST of the corpus.
+//===----------------------------------------------------------------------===//
+class BenchConsumer : public ASTConsumer {
+public:
+    explicit BenchConsumer(CompilerInstance* CI, StringRef InFile) : CI(CI), InFile(InFile){}
+    
+    virtual void HandleTranslationUnit(ASTContext& Context){
+        EhminerBench::runASTBenchmarks(CI, Context, InFile);
+    }
+
+private:
+    CompilerInstance* CI;
+    StringRef InFile;
+};
+
+class BenchAction : public ASTFrontendAction {
+public:
+    virtual std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance& Compiler, StringRef InFile){
+        return std::unique_ptr<ASTConsumer>(new BenchConsumer(&Compiler, InFile));
+    }
+};
+
+int main(int argc, const char **argv){
+    
+    cl::HideUnrelatedOptions(BenchCategory);
+    cl::ParseCommandLineOptions(argc, argv, "EH-Miner micro-benchmarks\n");
+    
+    CorpusGenerator::Options options;
+    options.functionNum = FunctionNum;
+    options.depth = Depth;
+    options.callDensity = CallDensity;
+    options.condComplexity = CondComplexity;
+    options.seed = Seed;
+    CorpusGenerator generator(options);
+    string code = generator.generate();
+    
+    if(DumpCorpus){
+        printf("%s", code.c_str());
+        return 0;
+    }
+    
+    // The domain of the corpus, with other domains and projects, so the lookup is not trivial
+    ConfigData configData;
+    for(unsigned i = 0; i < 8; i++){
+        char name[32];
+        sprintf(name, "domain%u", i);
+        configData.addDomainName(name);
+        for(unsigned j = 0; j < 8; j++){
+            sprintf(name, "project%u", j);
+            configData.addProjectName(i, name);
+        }
+    }
+    configData.addDomainName(CORPUS_DOMAIN);
+    configData.addProjectName(8, CORPUS_PROJECT);
+    
+    fprintf(stderr, "Corpus: %u functions, depth %u, %u calls per block, %u sub-conditions, %lu bytes\n",
+            options.functionNum, options.depth, options.callDensity, options.condComplexity, code.size());
+    
+    EhminerBench::printHeader();
+    
+    vector<string> args;
+    args.push_back("-w");
+    args.push_back("-std=gnu99");
+    if(!runToolOnCodeWithArgs(new BenchAction, code, args, CORPUS_FILE)){
+        fprintf(stderr, "Fail to parse the corpus!\n");
+        return 1;
+    }
+    
+    EhminerBench::runDataBenchmarks();
+    return 0;
+}
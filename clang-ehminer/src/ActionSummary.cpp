@@ -0,0 +1,337 @@
+//===------ ActionSummary.cpp - The actions of functions over the call graph ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the summaries of the actions of functions, e.g., exit
+// or output, computed bottom-up over the strongly connected components of the
+// call graph.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ActionSummary.h"
+
+#include <algorithm>
+
+const unsigned ActionSummary::MAX_LEVEL;
+
+// The names of the actions, the same as the intentions in table function_action
+static const char* actionName[ActionSummary::ACTION_NUM] = {
+    "exit", "output", "free", "delete", "close", "return", "goto", "break", "continue"
+};
+
+// The action functions and the keywords of each action, the lists end with NULL
+static const char* actionFunctions[ActionSummary::ACTION_NUM][24] = {
+    {"abort", "exit", "kill", "killpg", "raise", "alarm", "signal", NULL},
+    {"printf", "fprintf", "dprintf", "vprintf", "vfprintf", "vdprintf", "fputs", "puts", "fwrite",
+     "perror", "psignal", "psiginfo", "syslog", "pwrite", "write", "writev", "written", "msgsnd",
+     "send", "sendto", "sendmsg", NULL},
+    {"free", NULL},
+    {"remove", "unlink", "unlinkat", "rmdir", NULL},
+    {"close", "fclose", "pclose", "shutdown", "closelog", NULL},
+    {"return", NULL},
+    {"goto", NULL},
+    {"break", NULL},
+    {"continue", NULL}
+};
+static const char* actionKeywords[ActionSummary::ACTION_NUM][48] = {
+    {"abort", "exit", "die", "kill", "quit", "stop", NULL},
+    {"error", "err", "warn", "alert", "assert", "fail", "crit", "emerg", "out", "exit", "die", "halt",
+     "suspend", "wrong", "fatal", "fault", "misplay", "damage", "illegal", "exception", "errmsg", "abort", "msg",
+     "record", "report", "stop", "quit", "close", "put", "print", "write", "log", "message", "dump", "hint",
+     "trace", "notify", NULL},
+    {"free", "clean", "clear", NULL},
+    {"rm", "unlink", "del", "clean", NULL},
+    {"close", "shutdown", NULL},
+    {"return", NULL},
+    {"goto", NULL},
+    {"break", NULL},
+    {"continue", NULL}
+};
+
+// The keywords and action functions are letters only, so the other characters
+// are one class, which no pattern has
+#define LETTER_NUM 26
+#define CLASS_NUM (LETTER_NUM + 1)
+
+// Get the class of a character, case-insensitively
+static inline unsigned getCharClass(unsigned char c){
+    if(c >= 'a' && c <= 'z')
+        return c - 'a' + 1;
+    if(c >= 'A' && c <= 'Z')
+        return c - 'A' + 1;
+    return 0;
+}
+
+// An Aho-Corasick automaton over the keywords and the action functions of all the
+// actions, so a name is classified by one scan. The keywords match anywhere in the
+// name case-insensitively, and the action functions match the whole name exactly.
+class ActionAutomaton{
+public:
+    ActionAutomaton(){
+        addState(0);
+        for(unsigned i = 0; i < ActionSummary::ACTION_NUM; i++){
+            for(unsigned j = 0; actionKeywords[i][j]; j++)
+                keywordMask[addPattern(actionKeywords[i][j])] |= 1u << i;
+            for(unsigned j = 0; actionFunctions[i][j]; j++)
+                functionMask[addPattern(actionFunctions[i][j])] |= 1u << i;
+        }
+        buildFailure();
+    }
+    
+    // Scan a name once, and get the actions of its whole name and its keywords
+    void classify(const char* name, unsigned& functions, unsigned& keywords) const{
+        unsigned state = 0;
+        unsigned length = 0;
+        bool exact = true;
+        keywords = 0;
+        for(const char* c = name; *c; c++, length++){
+            unsigned charClass = getCharClass(*c);
+            if(charClass == 0 || (*c >= 'A' && *c <= 'Z'))
+                exact = false;
+            state = next[state * CLASS_NUM + charClass];
+            keywords |= keywordMask[state];
+        }
+        
+        // A state as deep as the name is the path of the whole name in the trie
+        functions = exact && depth[state] == length ? functionMask[state] : 0;
+    }
+
+private:
+    // Add a state of the given depth
+    unsigned addState(unsigned stateDepth){
+        next.resize(next.size() + CLASS_NUM, 0);
+        depth.push_back(stateDepth);
+        keywordMask.push_back(0);
+        functionMask.push_back(0);
+        return depth.size() - 1;
+    }
+    
+    // Add a pattern to the trie, return its last state
+    unsigned addPattern(const char* pattern){
+        unsigned state = 0;
+        for(const char* c = pattern; *c; c++){
+            unsigned charClass = getCharClass(*c);
+            if(next[state * CLASS_NUM + charClass] == 0){
+                unsigned newState = addState(depth[state] + 1);
+                next[state * CLASS_NUM + charClass] = newState;
+            }
+            state = next[state * CLASS_NUM + charClass];
+        }
+        return state;
+    }
+    
+    // Link each state to its longest proper suffix in the trie, and complete the
+    // transitions, so scanning a character is one lookup
+    void buildFailure(){
+        vector<unsigned> failure(depth.size(), 0);
+        vector<unsigned> queue;
+        for(unsigned charClass = 1; charClass < CLASS_NUM; charClass++){
+            if(next[charClass])
+                queue.push_back(next[charClass]);
+        }
+        for(unsigned i = 0; i < queue.size(); i++){
+            unsigned state = queue[i];
+            keywordMask[state] |= keywordMask[failure[state]];
+            for(unsigned charClass = 0; charClass < CLASS_NUM; charClass++){
+                unsigned& child = next[state * CLASS_NUM + charClass];
+                unsigned fallback = next[failure[state] * CLASS_NUM + charClass];
+                if(child){
+                    failure[child] = fallback;
+                    queue.push_back(child);
+                }
+                else
+                    child = fallback;
+            }
+        }
+    }
+    
+    // The transitions, CLASS_NUM per state, and the depth of each state in the trie
+    vector<unsigned> next;
+    vector<unsigned> depth;
+    
+    // The actions of the keywords ending at each state, including its suffixes,
+    // and the actions of the action function spelled by each state
+    vector<unsigned> keywordMask;
+    vector<unsigned> functionMask;
+};
+
+// Get the automaton, built at the first use
+static const ActionAutomaton& getAutomaton(){
+    static const ActionAutomaton automaton;
+    return automaton;
+}
+
+// Get the name of an action
+const char* ActionSummary::getActionName(unsigned action){
+    return action < ACTION_NUM ? actionName[action] : "";
+}
+
+// Get the actions of which a function is an action function, and the actions
+// whose keywords are in its name, by one scan of the name
+void ActionSummary::classify(const char* name, unsigned& functionMask, unsigned& keywordMask){
+    getAutomaton().classify(name, functionMask, keywordMask);
+}
+
+// Get the actions of which a function is an action function
+unsigned ActionSummary::getFunctionMask(const char* name){
+    unsigned functionMask, keywordMask;
+    classify(name, functionMask, keywordMask);
+    return functionMask;
+}
+
+// Get the actions whose keywords are in the name of a function, case-insensitively
+unsigned ActionSummary::getKeywordMask(const char* name){
+    unsigned functionMask, keywordMask;
+    classify(name, functionMask, keywordMask);
+    return keywordMask;
+}
+
+// Get the actions a name stands for, as an action function or by its keywords
+unsigned ActionSummary::getNameMask(const char* name){
+    unsigned functionMask, keywordMask;
+    classify(name, functionMask, keywordMask);
+    return functionMask | keywordMask;
+}
+
+// Get the actions taken by a function
+unsigned ActionSummary::getMask(unsigned node) const{
+    unsigned mask = 0;
+    for(unsigned i = 0; i < ACTION_NUM; i++){
+        if(getLevel(node, i))
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+// Summarize the functions of a strongly connected component
+void ActionSummary::summarizeComponent(const CallGraphIndex& graph, const vector<unsigned>& component){
+    
+    unsigned componentID = componentOf[component[0]];
+    
+    // The action functions take their actions at level 1, and the others take
+    // the actions of the callees out of the component one level deeper
+    for(unsigned i = 0; i < component.size(); i++){
+        unsigned node = component[i];
+        uint8_t* level = &levels[node * ACTION_NUM];
+        for(unsigned action = 0; action < ACTION_NUM; action++){
+            if(functionMask[node] & (1u << action))
+                level[action] = 1;
+        }
+        
+        unsigned pendingMask = keywordMask[node] & ~functionMask[node];
+        if(!pendingMask)
+            continue;
+        for(const uint32_t* callee = graph.calleeBegin(node); callee != graph.calleeEnd(node); ++callee){
+            if(componentOf[*callee] == componentID)
+                continue;
+            const uint8_t* calleeLevel = &levels[*callee * ACTION_NUM];
+            for(unsigned action = 0; action < ACTION_NUM; action++){
+                if((pendingMask & (1u << action)) && calleeLevel[action] && calleeLevel[action] < MAX_LEVEL &&
+                   (!level[action] || calleeLevel[action] + 1 < level[action]))
+                    level[action] = calleeLevel[action] + 1;
+            }
+        }
+    }
+    
+    // Relax the calls in the component, a level only decreases, and each
+    // round fixes the functions one more call away, so at most MAX_LEVEL rounds
+    if(component.size() == 1 && !binary_search(graph.calleeBegin(component[0]), graph.calleeEnd(component[0]), component[0]))
+        return;
+    bool changed = true;
+    for(unsigned round = 0; changed && round < MAX_LEVEL; round++){
+        changed = false;
+        for(unsigned i = 0; i < component.size(); i++){
+            unsigned node = component[i];
+            uint8_t* level = &levels[node * ACTION_NUM];
+            for(const uint32_t* callee = graph.calleeBegin(node); callee != graph.calleeEnd(node); ++callee){
+                if(componentOf[*callee] != componentID)
+                    continue;
+                const uint8_t* calleeLevel = &levels[*callee * ACTION_NUM];
+                for(unsigned action = 0; action < ACTION_NUM; action++){
+                    if((keywordMask[node] & (1u << action)) && calleeLevel[action] && calleeLevel[action] < MAX_LEVEL &&
+                       (!level[action] || calleeLevel[action] + 1 < level[action])){
+                        level[action] = calleeLevel[action] + 1;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Summarize all the functions, the components are found by Tarjan's algorithm,
+// which finishes a component after the components it calls
+void ActionSummary::compute(const CallGraphIndex& graph){
+    
+    unsigned nodeNum = graph.getNodeNum();
+    levels.assign((size_t) nodeNum * ACTION_NUM, 0);
+    functionMask.resize(nodeNum);
+    keywordMask.resize(nodeNum);
+    for(unsigned i = 0; i < nodeNum; i++)
+        classify(graph.getName(i), functionMask[i], keywordMask[i]);
+    componentOf.assign(nodeNum, CallGraphIndex::NONE);
+    
+    // The call stack of the depth-first search is explicit, since the call
+    // chains of large programs are deep
+    struct Frame{
+        unsigned node;
+        const uint32_t* callee;
+    };
+    vector<Frame> frames;
+    vector<unsigned> index(nodeNum, CallGraphIndex::NONE);
+    vector<unsigned> lowLink(nodeNum, 0);
+    vector<unsigned> stack;
+    vector<unsigned> component;
+    unsigned nextIndex = 0;
+    unsigned componentNum = 0;
+    
+    for(unsigned root = 0; root < nodeNum; root++){
+        if(index[root] != CallGraphIndex::NONE)
+            continue;
+        
+        index[root] = lowLink[root] = nextIndex++;
+        stack.push_back(root);
+        frames.push_back(Frame{root, graph.calleeBegin(root)});
+        while(!frames.empty()){
+            unsigned node = frames.back().node;
+            
+            // Go on to the next callee
+            if(frames.back().callee != graph.calleeEnd(node)){
+                unsigned callee = *frames.back().callee++;
+                if(index[callee] == CallGraphIndex::NONE){
+                    index[callee] = lowLink[callee] = nextIndex++;
+                    stack.push_back(callee);
+                    frames.push_back(Frame{callee, graph.calleeBegin(callee)});
+                }
+                else if(componentOf[callee] == CallGraphIndex::NONE)
+                    lowLink[node] = min(lowLink[node], index[callee]);
+                continue;
+            }
+            
+            // All the callees are visited
+            frames.pop_back();
+            if(!frames.empty())
+                lowLink[frames.back().node] = min(lowLink[frames.back().node], lowLink[node]);
+            if(lowLink[node] != index[node])
+                continue;
+            
+            // The node is the root of a component on the stack
+            component.clear();
+            unsigned member;
+            do{
+                member = stack.back();
+                stack.pop_back();
+                componentOf[member] = componentNum;
+                component.push_back(member);
+            }while(member != node);
+            componentNum++;
+            summarizeComponent(graph, component);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+//===- ActionSummary.h - The actions of functions over the call graph -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the summaries of the actions of functions, e.g., exit
+// or output, computed bottom-up over the strongly connected components of the
+// call graph.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ActionSummary_h
+#define ActionSummary_h
+
+#include "CallGraphIndex.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//===----------------------------------------------------------------------===//
+//
+//                     ActionSummary Class
+//
+//===----------------------------------------------------------------------===//
+// The same actions as get_function_action in py/analyzer.py. A function takes
+// an action at level 1 if it is an action function of the action, e.g., exit,
+// and at level n + 1 if its name has a keyword of the action, e.g., "die", and
+// it calls a function taking the action at level n. The levels are at most
+// MAX_LEVEL, the depth of the breadth-first search of analyzer.py.
+//
+// The callees of a function are summarized before it, and the functions in a
+// cycle are relaxed together, so each function is summarized once for all the
+// actions, instead of once per caller and per action. A name is classified by
+// one scan of a keyword automaton, instead of one substring test per keyword.
+//===----------------------------------------------------------------------===//
+class ActionSummary{
+public:
+    enum Action{
+        ACTION_EXIT,
+        ACTION_OUTPUT,
+        ACTION_FREE,
+        ACTION_DELETE,
+        ACTION_CLOSE,
+        ACTION_RETURN,
+        ACTION_GOTO,
+        ACTION_BREAK,
+        ACTION_CONTINUE,
+        ACTION_NUM
+    };
+    
+    // The largest level of an action
+    static const unsigned MAX_LEVEL = 20;
+    
+    // Get the name of an action, e.g., "exit"
+    static const char* getActionName(unsigned action);
+    
+    // Get the actions of which a function is an action function, and the actions
+    // whose keywords are in its name, as bitmasks, by one scan of the name
+    static void classify(const char* name, unsigned& functionMask, unsigned& keywordMask);
+    
+    // Get the actions of which a function is an action function, as a bitmask
+    static unsigned getFunctionMask(const char* name);
+    
+    // Get the actions whose keywords are in the name of a function, as a bitmask
+    static unsigned getKeywordMask(const char* name);
+    
+    // Get the actions a name stands for, as an action function or by its keywords
+    static unsigned getNameMask(const char* name);
+    
+    // Summarize all the functions of a call graph
+    void compute(const CallGraphIndex& graph);
+    
+    // Get the actions taken by a function, as a bitmask
+    unsigned getMask(unsigned node) const;
+    
+    // Get the level of an action taken by a function, 0 if it is not taken
+    unsigned getLevel(unsigned node, unsigned action) const { return levels[node * ACTION_NUM + action]; }
+
+private:
+    // Summarize the functions of a strongly connected component, whose callees
+    // out of the component are summarized
+    void summarizeComponent(const CallGraphIndex& graph, const vector<unsigned>& component);
+    
+    // The levels of the actions of each function, ACTION_NUM per function
+    vector<uint8_t> levels;
+    
+    // The actions of which each function is an action function, and the
+    // actions whose keywords are in the name of each function
+    vector<unsigned> functionMask;
+    vector<unsigned> keywordMask;
+    
+    // The component of each function, a function is summarized if it is set
+    vector<unsigned> componentOf;
+};
+
+#endif /* ActionSummary_h */
@@ -0,0 +1,216 @@
+//===------ CallDataflow.cpp - Reaching definitions of function call results ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a dataflow analysis finding the calls whose results
+// reach each branch statement of a function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallDataflow.h"
+
+#include <deque>
+
+// Get the variable or field written or read by an expr, e.g., err for '&err', or nullptr
+const ValueDecl* CallDataflow::getKeyDecl(const Expr* expr){
+    
+    if(!expr)
+        return nullptr;
+    expr = expr->IgnoreParenCasts();
+    
+    // Remove the & and *, e.g., &error -> error
+    while(auto *unaryOperator = dyn_cast<UnaryOperator>(expr)){
+        if(unaryOperator->getOpcode() != UO_Deref && unaryOperator->getOpcode() != UO_AddrOf)
+            break;
+        expr = unaryOperator->getSubExpr()->IgnoreParenCasts();
+    }
+    
+    if(auto *declRefExpr = dyn_cast<DeclRefExpr>(expr))
+        return dyn_cast<VarDecl>(declRefExpr->getDecl());
+    if(auto *memberExpr = dyn_cast<MemberExpr>(expr))
+        return memberExpr->getMemberDecl();
+    if(auto *arraySubscriptExpr = dyn_cast<ArraySubscriptExpr>(expr))
+        return getKeyDecl(arraySubscriptExpr->getBase());
+    return nullptr;
+}
+
+// Collect the variables and fields used in a stmt
+void CallDataflow::collectKeyDecls(const Stmt* stmt, set<const ValueDecl*>& keys){
+    
+    if(!stmt)
+        return;
+    
+    if(auto *declRefExpr = dyn_cast<DeclRefExpr>(stmt)){
+        if(auto *varDecl = dyn_cast<VarDecl>(declRefExpr->getDecl()))
+            keys.insert(varDecl);
+    }
+    if(auto *memberExpr = dyn_cast<MemberExpr>(stmt))
+        keys.insert(memberExpr->getMemberDecl());
+    
+    for(Stmt::const_child_iterator it = stmt->child_begin(); it != stmt->child_end(); ++it)
+        collectKeyDecls(*it, keys);
+}
+
+// Apply a CFG element to the facts, only assignments and declarations change them
+void CallDataflow::transfer(const Stmt* stmt, CallFacts& facts){
+    
+    const ValueDecl* key = nullptr;
+    const Expr* value = nullptr;
+    
+    if(auto *binaryOperator = dyn_cast<BinaryOperator>(stmt)){
+        if(binaryOperator->getOpcode() != BO_Assign)
+            return;
+        key = getKeyDecl(binaryOperator->getLHS());
+        value = binaryOperator->getRHS();
+    }
+    else if(auto *declStmt = dyn_cast<DeclStmt>(stmt)){
+        // The CFG splits a DeclStmt with several decls into single ones
+        if(!declStmt->isSingleDecl())
+            return;
+        if(auto *varDecl = dyn_cast<VarDecl>(declStmt->getSingleDecl())){
+            key = varDecl;
+            value = varDecl->getInit();
+        }
+    }
+    
+    if(!key)
+        return;
+    
+    set<CallFact> newFacts;
+    if(value){
+        value = value->IgnoreParenCasts();
+        
+        // For 'a = b = foo()', a takes the facts of b, which is assigned before
+        while(auto *assign = dyn_cast<BinaryOperator>(value)){
+            if(assign->getOpcode() != BO_Assign)
+                break;
+            value = assign->getLHS()->IgnoreParenCasts();
+        }
+        
+        if(auto *callExpr = dyn_cast<CallExpr>(value)){
+            if(callExpr->getDirectCallee()){
+                CallFact result = {callExpr, true};
+                newFacts.insert(result);
+                
+                // The arguments are related to the call, e.g., 'ret = foo(&err); if(err)'
+                for(unsigned i = 0; i < callExpr->getNumArgs(); i++){
+                    const ValueDecl* argKey = getKeyDecl(callExpr->getArg(i));
+                    if(argKey && argKey != key){
+                        CallFact argument = {callExpr, false};
+                        facts[argKey].insert(argument);
+                    }
+                }
+            }
+        }
+        // Copy the results, e.g., 'a = ret'
+        else if(const ValueDecl* from = getKeyDecl(value)){
+            CallFacts::iterator it = facts.find(from);
+            if(it != facts.end()){
+                for(set<CallFact>::iterator fact = it->second.begin(); fact != it->second.end(); ++fact)
+                    if(fact->isResult)
+                        newFacts.insert(*fact);
+            }
+        }
+    }
+    
+    // The other assignments kill the facts
+    if(newFacts.empty())
+        facts.erase(key);
+    else
+        facts[key] = newFacts;
+}
+
+// Build the CFG of the function body and compute the facts, return false if the CFG can't be built
+bool CallDataflow::run(const Decl* decl, Stmt* body, ASTContext& context){
+    
+    branchFacts.clear();
+    
+    // Add all the stmts to CFG blocks, including the assignments nested in exprs
+    CFG::BuildOptions options;
+    options.setAllAlwaysAdd();
+    std::unique_ptr<CFG> cfg = CFG::buildCFG(decl, body, &context, options);
+    if(!cfg)
+        return false;
+    
+    unsigned blockNum = cfg->getNumBlockIDs();
+    vector<const CFGBlock*> blocks(blockNum, nullptr);
+    for(CFG::const_iterator it = cfg->begin(); it != cfg->end(); ++it)
+        blocks[(*it)->getBlockID()] = *it;
+    
+    // The facts at the entry of each block, which only grow, so the worklist stops
+    vector<CallFacts> entryFacts(blockNum);
+    vector<bool> reached(blockNum, false);
+    vector<bool> queued(blockNum, false);
+    deque<const CFGBlock*> worklist;
+    
+    const CFGBlock* entry = &cfg->getEntry();
+    reached[entry->getBlockID()] = true;
+    queued[entry->getBlockID()] = true;
+    worklist.push_back(entry);
+    
+    while(!worklist.empty()){
+        const CFGBlock* block = worklist.front();
+        worklist.pop_front();
+        queued[block->getBlockID()] = false;
+        
+        CallFacts facts = entryFacts[block->getBlockID()];
+        for(CFGBlock::const_iterator element = block->begin(); element != block->end(); ++element)
+            if(Optional<CFGStmt> cfgStmt = element->getAs<CFGStmt>())
+                transfer(cfgStmt->getStmt(), facts);
+        
+        for(CFGBlock::const_succ_iterator it = block->succ_begin(); it != block->succ_end(); ++it){
+            const CFGBlock* succ = *it;
+            if(!succ)
+                continue;
+            unsigned succID = succ->getBlockID();
+            
+            // Merge the facts into the successor
+            bool changed = !reached[succID];
+            reached[succID] = true;
+            CallFacts& succFacts = entryFacts[succID];
+            for(CallFacts::iterator fact = facts.begin(); fact != facts.end(); ++fact){
+                set<CallFact>& succSet = succFacts[fact->first];
+                size_t size = succSet.size();
+                succSet.insert(fact->second.begin(), fact->second.end());
+                if(succSet.size() != size)
+                    changed = true;
+            }
+            
+            if(changed && !queued[succID]){
+                queued[succID] = true;
+                worklist.push_back(succ);
+            }
+        }
+    }
+    
+    // The facts at the if and switch statements, the blocks are numbered backwards,
+    // so a larger ID is usually earlier in the source code
+    for(unsigned i = blockNum; i > 0; i--){
+        const CFGBlock* block = blocks[i - 1];
+        if(!block || !reached[i - 1])
+            continue;
+        
+        Stmt* terminator = const_cast<CFGBlock*>(block)->getTerminator().getStmt();
+        if(!terminator || (!isa<IfStmt>(terminator) && !isa<SwitchStmt>(terminator)))
+            continue;
+        
+        CallFacts facts = entryFacts[i - 1];
+        for(CFGBlock::const_iterator element = block->begin(); element != block->end(); ++element)
+            if(Optional<CFGStmt> cfgStmt = element->getAs<CFGStmt>())
+                transfer(cfgStmt->getStmt(), facts);
+        branchFacts.push_back(make_pair(terminator, facts));
+    }
+    
+    return true;
+}
+
+// The facts at each if and switch statement, in the order of CFG blocks
+const vector<pair<Stmt*, CallDataflow::CallFacts>>& CallDataflow::getBranchFacts(){
+    return branchFacts;
+}
@@ -0,0 +1,80 @@
+//===- CallDataflow.h - Reaching definitions of function call results -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a dataflow analysis finding the calls whose results
+// reach each branch statement of a function.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CallDataflow_h
+#define CallDataflow_h
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Analysis/CFG.h"
+
+using namespace std;
+using namespace clang;
+
+//===----------------------------------------------------------------------===//
+//
+//                     CallDataflow Class
+//
+//===----------------------------------------------------------------------===//
+// We build the CFG of a function once, and compute the reaching definitions of
+// call results in one forward analysis. A variable (or a field) is related to a
+// call when it is assigned the result, e.g., 'ret = foo()', 'int ret = foo()' and
+// 'a = ret', or it is an argument of such a call, e.g., '&err' in 'ret = foo(&err)'.
+// Any other assignment to the variable kills its facts. Variables are identified
+// by their declarations, so a shadowing variable with the same name never matches.
+//===----------------------------------------------------------------------===//
+class CallDataflow{
+public:
+    // A fact says a variable holds the result of a call, or is an argument of the call
+    struct CallFact{
+        const CallExpr* callExpr;
+        bool isResult;
+        
+        bool operator<(const CallFact& other) const{
+            return callExpr != other.callExpr ? callExpr < other.callExpr : isResult < other.isResult;
+        }
+    };
+    
+    // The facts of each variable at a program point
+    typedef map<const ValueDecl*, set<CallFact>> CallFacts;
+    
+    // Build the CFG of the function body and compute the facts, return false if the CFG can't be built
+    bool run(const Decl* decl, Stmt* body, ASTContext& context);
+    
+    // The facts at each if and switch statement, in the order of CFG blocks
+    const vector<pair<Stmt*, CallFacts>>& getBranchFacts();
+    
+    // Get the variable or field written or read by an expr, e.g., err for '&err', or nullptr
+    static const ValueDecl* getKeyDecl(const Expr* expr);
+    
+    // Collect the variables and fields used in a stmt
+    static void collectKeyDecls(const Stmt* stmt, set<const ValueDecl*>& keys);
+
+private:
+    // Apply a CFG element to the facts
+    void transfer(const Stmt* stmt, CallFacts& facts);
+    
+    // The facts at each if and switch statement
+    vector<pair<Stmt*, CallFacts>> branchFacts;
+};
+
+#endif /* CallDataflow_h */
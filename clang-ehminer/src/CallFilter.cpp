@@ -0,0 +1,159 @@
+//===------ CallFilter.cpp - The target functions of the branch extraction ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the set of target functions, whose calls are the only
+// ones searched for checks, and a prefilter for the files without them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallFilter.h"
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "clang/AST/Expr.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Lex/Lexer.h"
+
+#include <fstream>
+#include <sstream>
+
+llvm::StringSet<> CallFilter::targets;
+llvm::StringSet<> CallFilter::includes;
+llvm::StringSet<> CallFilter::excludes;
+bool CallFilter::census = false;
+bool CallFilter::fileSkipped = false;
+
+// Split a line by the separator, or by spaces if the separator is 0
+static vector<string> splitLine(const string& line, char separator){
+    vector<string> fields;
+    if(separator){
+        stringstream stream(line);
+        string field;
+        while(getline(stream, field, separator))
+            fields.push_back(field);
+    }
+    else{
+        stringstream stream(line);
+        string field;
+        while(stream >> field)
+            fields.push_back(field);
+    }
+    return fields;
+}
+
+// Load the target functions from a list or a CSV file
+bool CallFilter::loadTargets(string file){
+    
+    ifstream input(file.c_str());
+    if(!input){
+        fprintf(stderr, "Can't open target function file: %s\n", file.c_str());
+        return false;
+    }
+    
+    // The names are in the CallName column of a CSV file, or the first field of each line
+    char separator = 0;
+    unsigned column = 0;
+    string line;
+    bool firstLine = true;
+    while(getline(input, line)){
+        if(!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if(line.empty() || line[0] == '#')
+            continue;
+        
+        if(firstLine){
+            firstLine = false;
+            vector<string> header = splitLine(line, ',');
+            for(unsigned i = 0; i < header.size(); i++){
+                if(header[i] == "CallName"){
+                    separator = ',';
+                    column = i;
+                }
+            }
+            if(separator)
+                continue;
+        }
+        
+        vector<string> fields = splitLine(line, separator);
+        if(column < fields.size() && !fields[column].empty())
+            targets.insert(fields[column]);
+    }
+    return true;
+}
+
+// Keep only the target functions in names, or take all of them if no target is given
+void CallFilter::retainTargets(const vector<string>& names){
+    
+    llvm::StringSet<> retained;
+    for(unsigned i = 0; i < names.size(); i++){
+        if(targets.empty() || targets.count(names[i]))
+            retained.insert(names[i]);
+    }
+    targets = retained;
+}
+
+// Whether the calls of a function are recorded
+bool CallFilter::isRecorded(const FunctionDecl* callee){
+    
+    // The name of an operator or a destructor is not an identifier, so it is built
+    const IdentifierInfo* identifier = callee->getIdentifier();
+    string builtName;
+    StringRef name;
+    if(identifier)
+        name = identifier->getName();
+    else{
+        builtName = callee->getNameAsString();
+        name = builtName;
+    }
+    
+    if(name.find("operator") != StringRef::npos || name.find("__builtin") != StringRef::npos)
+        return false;
+    if(excludes.count(name))
+        return false;
+    return includes.empty() || includes.count(name);
+}
+
+// Whether a stmt calls a target function
+bool CallFilter::stmtHasTarget(const Stmt* stmt){
+    
+    if(!stmt)
+        return false;
+    
+    if(auto *callExpr = dyn_cast<CallExpr>(stmt)){
+        if(const FunctionDecl* callee = callExpr->getDirectCallee()){
+            if(callee->getIdentifier() && targets.count(callee->getName()))
+                return true;
+        }
+    }
+    
+    for(Stmt::const_child_iterator it = stmt->child_begin(); it != stmt->child_end(); ++it)
+        if(stmtHasTarget(*it))
+            return true;
+    return false;
+}
+
+// Whether the raw tokens of a file have the name of a target function
+bool CallFilter::fileHasTarget(string file){
+    
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(file);
+    if(!buffer)
+        return true;
+    
+    // The raw lexer needs no preprocessor, the identifiers and keywords are all raw identifiers
+    LangOptions langOpts;
+    StringRef text = (*buffer)->getBuffer();
+    Lexer lexer(SourceLocation(), langOpts, text.begin(), text.begin(), text.end());
+    Token token;
+    do{
+        lexer.LexFromRawLexer(token);
+        if(token.is(tok::raw_identifier) && targets.count(token.getRawIdentifier()))
+            return true;
+    }while(token.isNot(tok::eof));
+    return false;
+}
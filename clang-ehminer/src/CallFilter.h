@@ -0,0 +1,96 @@
+//===- CallFilter.h - The target functions of the branch extraction -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the set of target functions, whose calls are the only
+// ones searched for checks, and a prefilter skipping the files without them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CallFilter_h
+#define CallFilter_h
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringSet.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/Stmt.h"
+
+using namespace std;
+using namespace clang;
+
+//===----------------------------------------------------------------------===//
+//
+//                     CallFilter Class
+//
+//===----------------------------------------------------------------------===//
+// When target functions are given, only their calls are recorded in branch_call.
+// A function calling none of them only records the call statistics, and with the
+// prefilter, no function of a source file whose raw tokens have none of their
+// names is searched for checks, without walking each function body. The file is
+// still parsed for the call statistics and the call graph. The raw tokens are
+// those of the main file, so a call hidden in a macro defined in a header is
+// missed by the prefilter.
+// In the census pass of a two-pass extraction, no function is searched for checks.
+// The include and exclude lists of the config file decide the functions whose
+// calls are recorded at all, in branch_call, function_call and call_statistic.
+// All members are static so that the filter can be checked all around.
+//===----------------------------------------------------------------------===//
+class CallFilter{
+public:
+    // Load the target functions, one name per line, or the CallName column of a
+    // CSV file like py/glibc_return.csv, return false if the file can't be read
+    static bool loadTargets(string file);
+    
+    // Keep only the target functions in names, or take all of them if no target is given
+    static void retainTargets(const vector<string>& names);
+    
+    // Add a function to the include list, only the calls of the listed functions are recorded
+    static void addInclude(StringRef name){ includes.insert(name); }
+    
+    // Add a function to the exclude list, e.g., an infallible function like strlen
+    static void addExclude(StringRef name){ excludes.insert(name); }
+    
+    // Whether the calls of a function are recorded, by the include and exclude
+    // lists, operators and builtins are never recorded. This is checked before
+    // building any string of a call site.
+    static bool isRecorded(const FunctionDecl* callee);
+    
+    // Set whether only the call statistics are recorded, i.e., the census pass
+    static void setCensus(bool enable){ census = enable; }
+    
+    // Whether the target functions are given
+    static bool hasTargets(){ return !targets.empty(); }
+    
+    // Whether the calls of a function are searched for checks, all are if no target is given
+    static bool isTarget(StringRef name){ return targets.empty() || targets.count(name); }
+    
+    // Whether a stmt calls a target function, including the calls in macro expansions
+    static bool stmtHasTarget(const Stmt* stmt);
+    
+    // Whether the raw tokens of a file have the name of a target function,
+    // true if the file can't be read, so that the parser reports it
+    static bool fileHasTarget(string file);
+    
+    // Set whether no function of the current file is searched for checks, i.e., the file is prefiltered
+    static void setFileSkipped(bool skip){ fileSkipped = skip; }
+    
+    // Whether a function body is not searched for checks
+    static bool skipsFunction(const Stmt* body){ return census || fileSkipped || (hasTargets() && !stmtHasTarget(body)); }
+
+private:
+    static llvm::StringSet<> targets;
+    static llvm::StringSet<> includes;
+    static llvm::StringSet<> excludes;
+    static bool census;
+    static bool fileSkipped;
+};
+
+#endif /* CallFilter_h */
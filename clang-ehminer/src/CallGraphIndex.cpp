@@ -0,0 +1,383 @@
+//===------ CallGraphIndex.cpp - The call graph in compressed sparse row form ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a compact file of the call graph, and the queries of
+// reachability and depth-bounded traversals on it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The header of the call graph file
+struct CallGraphHeader{
+    char magic[8];
+    uint32_t nodeNum;
+    uint32_t edgeNum;
+    uint32_t stringBytes;
+    uint32_t reserved;
+};
+
+static const char callGraphMagic[8] = {'E', 'H', 'C', 'S', 'R', '0', '1', '\0'};
+
+// Get the ID of a function, add the function if it is new
+unsigned CallGraphBuilder::intern(const string& name, const string& defLoc){
+    
+    string key = name;
+    key += '\0';
+    key += defLoc;
+    
+    unordered_map<string, unsigned>::iterator it = nodeIDs.find(key);
+    if(it != nodeIDs.end())
+        return it->second;
+    
+    unsigned ID = nodes.size();
+    nodeIDs[key] = ID;
+    nodes.push_back(make_pair(name, defLoc));
+    return ID;
+}
+
+// Add an edge from a function to a function it calls
+void CallGraphBuilder::addEdge(const string& funcName, const string& funcDefLoc, const string& callName, const string& callDefLoc){
+    unsigned from = intern(funcName, funcDefLoc);
+    unsigned to = intern(callName, callDefLoc);
+    edges.push_back(make_pair(from, to));
+}
+
+// Lay out the call graph file in memory
+bool CallGraphBuilder::build(vector<char>& image) const{
+    
+    // Number the functions by name and definition location
+    vector<unsigned> order(nodes.size());
+    for(unsigned i = 0; i < order.size(); i++)
+        order[i] = i;
+    sort(order.begin(), order.end(), [this](unsigned a, unsigned b){
+        return nodes[a] < nodes[b];
+    });
+    vector<uint32_t> newID(nodes.size());
+    for(unsigned i = 0; i < order.size(); i++)
+        newID[order[i]] = i;
+    
+    // Sort the edges by caller and callee, and merge the duplicates
+    vector<pair<uint32_t, uint32_t>> sortedEdges;
+    sortedEdges.reserve(edges.size());
+    for(unsigned i = 0; i < edges.size(); i++)
+        sortedEdges.push_back(make_pair(newID[edges[i].first], newID[edges[i].second]));
+    sort(sortedEdges.begin(), sortedEdges.end());
+    sortedEdges.erase(unique(sortedEdges.begin(), sortedEdges.end()), sortedEdges.end());
+    
+    // The callees of each function are a range of targets
+    vector<uint32_t> offsets(nodes.size() + 1, 0);
+    vector<uint32_t> targets(sortedEdges.size());
+    for(unsigned i = 0; i < sortedEdges.size(); i++){
+        offsets[sortedEdges[i].first + 1]++;
+        targets[i] = sortedEdges[i].second;
+    }
+    for(unsigned i = 0; i < nodes.size(); i++)
+        offsets[i + 1] += offsets[i];
+    
+    // The names and definition locations in the string pool
+    vector<uint32_t> names(nodes.size());
+    string strings;
+    for(unsigned i = 0; i < order.size(); i++){
+        names[i] = strings.size();
+        strings += nodes[order[i]].first;
+        strings += '\0';
+        strings += nodes[order[i]].second;
+        strings += '\0';
+    }
+    if(strings.size() > UINT32_MAX){
+        fprintf(stderr, "The call graph is too large!\n");
+        return false;
+    }
+    
+    CallGraphHeader header;
+    memcpy(header.magic, callGraphMagic, sizeof(header.magic));
+    header.nodeNum = nodes.size();
+    header.edgeNum = targets.size();
+    header.stringBytes = strings.size();
+    header.reserved = 0;
+    
+    image.clear();
+    image.reserve(sizeof(header) + sizeof(uint32_t) * (offsets.size() + targets.size() + names.size()) + strings.size());
+    image.insert(image.end(), (const char*) &header, (const char*) (&header + 1));
+    image.insert(image.end(), (const char*) offsets.data(), (const char*) (offsets.data() + offsets.size()));
+    image.insert(image.end(), (const char*) targets.data(), (const char*) (targets.data() + targets.size()));
+    image.insert(image.end(), (const char*) names.data(), (const char*) (names.data() + names.size()));
+    image.insert(image.end(), strings.begin(), strings.end());
+    return true;
+}
+
+// Write the call graph to a file
+bool CallGraphBuilder::write(string file) const{
+    
+    vector<char> image;
+    if(!build(image))
+        return false;
+    
+    FILE* output = fopen(file.c_str(), "wb");
+    if(output == NULL){
+        fprintf(stderr, "Can't open call graph file: %s\n", file.c_str());
+        return false;
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), output) == image.size();
+    if(fclose(output) != 0)
+        ok = false;
+    if(!ok)
+        fprintf(stderr, "Can't write call graph file: %s\n", file.c_str());
+    return ok;
+}
+
+const unsigned CallGraphIndex::NONE;
+
+CallGraphIndex::~CallGraphIndex(){
+    unload();
+}
+
+// Release the loaded file
+void CallGraphIndex::unload(){
+    if(mapped)
+        munmap(mapped, mappedSize);
+    mapped = nullptr;
+    mappedSize = 0;
+    buffer.clear();
+    nodeNum = edgeNum = 0;
+    offsets = targets = names = nullptr;
+    strings = nullptr;
+    visitedEpoch.clear();
+    parentNode.clear();
+    epoch = 0;
+}
+
+// Load the call graph file
+bool CallGraphIndex::load(string file, bool useMmap){
+    
+    unload();
+    
+    int fd = open(file.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0){
+        fprintf(stderr, "Can't open call graph file: %s\n", file.c_str());
+        if(fd >= 0)
+            close(fd);
+        return false;
+    }
+    
+    // Map the file, or read it at once
+    size_t size = st.st_size;
+    const char* data = nullptr;
+    if(useMmap && size > 0){
+        void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr != MAP_FAILED){
+            mapped = addr;
+            mappedSize = size;
+            data = (const char*) addr;
+        }
+    }
+    if(!data){
+        buffer.resize(size);
+        size_t done = 0;
+        while(done < size){
+            ssize_t n = read(fd, buffer.data() + done, size - done);
+            if(n <= 0)
+                break;
+            done += n;
+        }
+        if(done != size){
+            fprintf(stderr, "Can't read call graph file: %s\n", file.c_str());
+            close(fd);
+            unload();
+            return false;
+        }
+        data = buffer.data();
+    }
+    close(fd);
+    
+    if(!parse(data, size, file)){
+        unload();
+        return false;
+    }
+    return true;
+}
+
+// Take a call graph laid out by CallGraphBuilder::build
+bool CallGraphIndex::assign(vector<char>& image){
+    
+    unload();
+    buffer.swap(image);
+    if(!parse(buffer.data(), buffer.size(), "<memory>")){
+        unload();
+        return false;
+    }
+    return true;
+}
+
+// Find the sections of a call graph file, and check them
+bool CallGraphIndex::parse(const char* data, size_t size, const string& file){
+    
+    // Check the header and the sizes of the sections
+    CallGraphHeader header;
+    if(size < sizeof(header) || memcmp(data, callGraphMagic, sizeof(callGraphMagic)) != 0){
+        fprintf(stderr, "Not a call graph file: %s\n", file.c_str());
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    uint64_t expected = sizeof(header) + sizeof(uint32_t) * ((uint64_t) header.nodeNum * 2 + 1 + header.edgeNum) + header.stringBytes;
+    if(expected != size){
+        fprintf(stderr, "The call graph file is truncated: %s\n", file.c_str());
+        return false;
+    }
+    
+    nodeNum = header.nodeNum;
+    edgeNum = header.edgeNum;
+    offsets = (const uint32_t*) (data + sizeof(header));
+    targets = offsets + nodeNum + 1;
+    names = targets + edgeNum;
+    strings = (const char*) (names + nodeNum);
+    
+    // A corrupted file should not make the queries read out of the sections
+    bool valid = offsets[nodeNum] == edgeNum && (header.stringBytes == 0 || strings[header.stringBytes - 1] == '\0');
+    for(unsigned i = 0; valid && i < nodeNum; i++)
+        valid = offsets[i] <= offsets[i + 1] && names[i] < header.stringBytes &&
+                names[i] + strlen(strings + names[i]) + 1 < header.stringBytes;
+    for(unsigned i = 0; valid && i < edgeNum; i++)
+        valid = targets[i] < nodeNum;
+    if(!valid){
+        fprintf(stderr, "The call graph file is corrupted: %s\n", file.c_str());
+        return false;
+    }
+    
+    visitedEpoch.assign(nodeNum, 0);
+    parentNode.assign(nodeNum, NONE);
+    return true;
+}
+
+// Get the definition location of a function, which follows its name
+const char* CallGraphIndex::getDefLoc(unsigned node) const{
+    const char* name = getName(node);
+    return name + strlen(name) + 1;
+}
+
+// Compare a function with a name and definition location
+int CallGraphIndex::compare(unsigned node, const string& name, const string& defLoc) const{
+    int result = strcmp(getName(node), name.c_str());
+    if(result != 0)
+        return result;
+    return strcmp(getDefLoc(node), defLoc.c_str());
+}
+
+// Get the ID of a function by binary search
+unsigned CallGraphIndex::lookup(const string& name, const string& defLoc) const{
+    unsigned low = 0, high = nodeNum;
+    while(low < high){
+        unsigned mid = low + (high - low) / 2;
+        int result = compare(mid, name, defLoc);
+        if(result == 0)
+            return mid;
+        if(result < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return NONE;
+}
+
+// Get the IDs of the functions with the name
+pair<unsigned, unsigned> CallGraphIndex::lookupName(const string& name) const{
+    
+    // The first function whose name is not less than the name
+    unsigned low = 0, high = nodeNum;
+    while(low < high){
+        unsigned mid = low + (high - low) / 2;
+        if(strcmp(getName(mid), name.c_str()) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    unsigned first = low;
+    
+    // The first function whose name is greater than the name
+    high = nodeNum;
+    while(low < high){
+        unsigned mid = low + (high - low) / 2;
+        if(strcmp(getName(mid), name.c_str()) <= 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return make_pair(first, low);
+}
+
+// Visit the functions reachable from source in breadth-first order
+void CallGraphIndex::traverse(unsigned source, unsigned maxDepth, const function<Visit(unsigned node, unsigned depth, unsigned parent)>& visit) const{
+    
+    if(source >= nodeNum)
+        return;
+    
+    // A new epoch unmarks all the functions, the marks are cleared when the epoch wraps
+    if(++epoch == 0){
+        fill(visitedEpoch.begin(), visitedEpoch.end(), 0);
+        epoch = 1;
+    }
+    
+    vector<unsigned> current(1, source), next;
+    visitedEpoch[source] = epoch;
+    parentNode[source] = NONE;
+    for(unsigned depth = 0; !current.empty(); depth++){
+        for(unsigned i = 0; i < current.size(); i++){
+            unsigned node = current[i];
+            Visit decision = visit(node, depth, parentNode[node]);
+            if(decision == VISIT_STOP)
+                return;
+            if(decision == VISIT_SKIP || depth >= maxDepth)
+                continue;
+            
+            for(const uint32_t* callee = calleeBegin(node); callee != calleeEnd(node); ++callee){
+                if(visitedEpoch[*callee] == epoch)
+                    continue;
+                visitedEpoch[*callee] = epoch;
+                parentNode[*callee] = node;
+                next.push_back(*callee);
+            }
+        }
+        current.swap(next);
+        next.clear();
+    }
+}
+
+// Whether target is reachable from source
+bool CallGraphIndex::isReachable(unsigned source, unsigned target, unsigned maxDepth) const{
+    bool found = false;
+    traverse(source, maxDepth, [&](unsigned node, unsigned, unsigned){
+        found = node == target;
+        return found ? VISIT_STOP : VISIT_EXPAND;
+    });
+    return found;
+}
+
+// Get the shortest call chain from source to target
+vector<unsigned> CallGraphIndex::getCallChain(unsigned source, unsigned target, unsigned maxDepth) const{
+    vector<unsigned> chain;
+    if(!isReachable(source, target, maxDepth))
+        return chain;
+    
+    // The parents of the visited functions lead back to source
+    for(unsigned node = target; node != NONE; node = parentNode[node])
+        chain.push_back(node);
+    reverse(chain.begin(), chain.end());
+    return chain;
+}
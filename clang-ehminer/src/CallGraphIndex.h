@@ -0,0 +1,169 @@
+//===- CallGraphIndex.h - The call graph in compressed sparse row form -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a compact file of the call graph, and the queries of
+// reachability and depth-bounded traversals on it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CallGraphIndex_h
+#define CallGraphIndex_h
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//===----------------------------------------------------------------------===//
+//
+//                     CallGraphBuilder Class
+//
+//===----------------------------------------------------------------------===//
+// A function is identified by its name and definition location, the same as
+// FuncName/FuncDefLoc and CallName/CallDefLoc in table call_graph, but with the
+// path instead of its ID when the path table is enabled. The file is
+// laid out as below, all integers are 32-bit in the byte order of the host:
+//
+//      header      magic "EHCSR01\0", node number, edge number, string bytes
+//      offsets     node number + 1 integers, the callees of node i are
+//                  targets[offsets[i]] to targets[offsets[i + 1] - 1]
+//      targets     edge number integers, sorted and unique for each node
+//      names       node number integers, the offsets of "name\0defloc\0"
+//                  in the string pool
+//      strings     the string pool
+//
+// The nodes are sorted by name and definition location, so a function is
+// found by binary search without building any table when loading.
+//===----------------------------------------------------------------------===//
+class CallGraphBuilder{
+public:
+    // Add a function, which may call or be called by no function
+    void addNode(const string& name, const string& defLoc){ intern(name, defLoc); }
+    
+    // Add an edge from a function to a function it calls, duplicates are merged
+    void addEdge(const string& funcName, const string& funcDefLoc, const string& callName, const string& callDefLoc);
+    
+    // Lay out the call graph file in memory, e.g., to query it by CallGraphIndex::assign
+    bool build(vector<char>& image) const;
+    
+    // Write the call graph to a file, return false if the file can't be written
+    bool write(string file) const;
+
+private:
+    // Get the ID of a function, add the function if it is new
+    unsigned intern(const string& name, const string& defLoc);
+    
+    // The IDs of the functions, indexed by the name and definition location joined by '\0'
+    unordered_map<string, unsigned> nodeIDs;
+    vector<pair<string, string>> nodes;
+    vector<pair<unsigned, unsigned>> edges;
+};
+
+//===----------------------------------------------------------------------===//
+//
+//                     CallGraphIndex Class
+//
+//===----------------------------------------------------------------------===//
+// The call graph file written by CallGraphBuilder, mapped to memory or read at
+// once. The traversals reuse a visited array of the index, so an index should
+// not be queried by several threads at the same time.
+//===----------------------------------------------------------------------===//
+class CallGraphIndex{
+public:
+    // The ID of a function that is not found
+    static const unsigned NONE = ~0u;
+    
+    // The decision of a traversal on a visited function
+    enum Visit{
+        // Go on to the callees of the function
+        VISIT_EXPAND,
+        // Don't go on to the callees of the function
+        VISIT_SKIP,
+        // Stop the traversal
+        VISIT_STOP
+    };
+    
+    CallGraphIndex(){}
+    ~CallGraphIndex();
+    
+    // Load the call graph file, by memory mapping if useMmap is set, return false
+    // if the file can't be read or is not a call graph file
+    bool load(string file, bool useMmap = true);
+    
+    // Take a call graph laid out by CallGraphBuilder::build, the image is moved into the index
+    bool assign(vector<char>& image);
+    
+    // Get the number of functions and calls
+    unsigned getNodeNum() const { return nodeNum; }
+    unsigned getEdgeNum() const { return edgeNum; }
+    
+    // Get the ID of a function, NONE if it is not found
+    unsigned lookup(const string& name, const string& defLoc) const;
+    
+    // Get the IDs [first, second) of the functions with the name, defined in different files
+    pair<unsigned, unsigned> lookupName(const string& name) const;
+    
+    // Get the name and definition location of a function
+    const char* getName(unsigned node) const { return strings + names[node]; }
+    const char* getDefLoc(unsigned node) const;
+    
+    // Get the functions called by a function, as the range [begin, end)
+    const uint32_t* calleeBegin(unsigned node) const { return targets + offsets[node]; }
+    const uint32_t* calleeEnd(unsigned node) const { return targets + offsets[node + 1]; }
+    
+    // Visit the functions reachable from source in at most maxDepth calls in
+    // breadth-first order, source is visited at depth 0 with parent NONE
+    void traverse(unsigned source, unsigned maxDepth, const function<Visit(unsigned node, unsigned depth, unsigned parent)>& visit) const;
+    
+    // Whether target is reachable from source in at most maxDepth calls
+    bool isReachable(unsigned source, unsigned target, unsigned maxDepth = ~0u) const;
+    
+    // Get the shortest call chain from source to target in at most maxDepth
+    // calls, including both, empty if target is not reachable
+    vector<unsigned> getCallChain(unsigned source, unsigned target, unsigned maxDepth = ~0u) const;
+
+private:
+    CallGraphIndex(const CallGraphIndex&) = delete;
+    CallGraphIndex& operator=(const CallGraphIndex&) = delete;
+    
+    // Release the loaded file
+    void unload();
+    
+    // Find the sections of a call graph file, and check them
+    bool parse(const char* data, size_t size, const string& file);
+    
+    // Compare a function with a name and definition location
+    int compare(unsigned node, const string& name, const string& defLoc) const;
+    
+    // The loaded file, mapped or read into buffer
+    void* mapped = nullptr;
+    size_t mappedSize = 0;
+    vector<char> buffer;
+    
+    // The sections of the file
+    unsigned nodeNum = 0;
+    unsigned edgeNum = 0;
+    const uint32_t* offsets = nullptr;
+    const uint32_t* targets = nullptr;
+    const uint32_t* names = nullptr;
+    const char* strings = nullptr;
+    
+    // The visited marks of the traversals, a function is visited in current
+    // traversal if its mark is the current epoch, and the parents of the visited
+    mutable vector<unsigned> visitedEpoch;
+    mutable vector<unsigned> parentNode;
+    mutable unsigned epoch = 0;
+};
+
+#endif /* CallGraphIndex_h */
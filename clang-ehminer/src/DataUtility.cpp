@@ -13,6 +13,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "DataUtility.h"
+#include "ExprCode.h"
+#include "CallGraphIndex.h"
+#include "ActionSummary.h"
+
+#include <algorithm>
 
 //===----------------------------------------------------------------------===//
 //
@@ -27,29 +32,112 @@
 // The memebers are static, and used to store the domain and project name in config file
 vector<string> ConfigData::domainName;
 vector<vector<string>> ConfigData::projectName;
+unordered_map<string, vector<unsigned>> ConfigData::domainIndex;
+vector<unordered_map<string, unsigned>> ConfigData::projectIndex;
+bool ConfigData::hasPlainNames = true;
+unordered_map<string, pair<int, int>> ConfigData::matchCache;
+
+// A name can be looked up as a path component if it has no '/'
+static bool isPlainName(const string& name){
+    return !name.empty() && name.find('/') == string::npos;
+}
 
 // Add a domain name from config file
 void ConfigData::addDomainName(string name){
+    domainIndex[name].push_back(domainName.size());
     domainName.push_back(name);
     vector<string> names;
     projectName.push_back(names);
+    projectIndex.push_back(unordered_map<string, unsigned>());
+    if(!isPlainName(name))
+        hasPlainNames = false;
+    matchCache.clear();
 }
 
 // Add a project in domain numbered domainIndex
 void ConfigData::addProjectName(unsigned int domainIndex, string name){
+    // Keep the first one if a project appears twice in a domain
+    projectIndex[domainIndex].insert(make_pair(name, projectName[domainIndex].size()));
     projectName[domainIndex].push_back(name);
+    if(!isPlainName(name))
+        hasPlainNames = false;
+    matchCache.clear();
 }
 
 // Get the 1-dim domain name
-vector<string> ConfigData::getDomainName(){
+const vector<string>& ConfigData::getDomainName(){
     return domainName;
 }
 
 // Get the 2-dim project name
-vector<vector<string>> ConfigData::getProjectName(){
+const vector<vector<string>>& ConfigData::getProjectName(){
     return projectName;
 }
 
+// Find the domain and project of a file path, the result is the index of the
+// first domain whose name is a component of the path, and the index of the first
+// project of this domain whose name is also a component, i.e., "/name/" is in
+// the path. Return (-1, -1) if no project matches. The results are cached per path.
+pair<int, int> ConfigData::matchDomainProject(const string& filePath){
+    
+    unordered_map<string, pair<int, int>>::iterator it = matchCache.find(filePath);
+    if(it != matchCache.end())
+        return it->second;
+    
+    pair<int, int> result = make_pair(-1, -1);
+    
+    if(hasPlainNames){
+        // Split the path into components enclosed by '/'
+        vector<string> components;
+        size_t begin = filePath.find('/');
+        while(begin != string::npos){
+            size_t end = filePath.find('/', begin + 1);
+            if(end == string::npos)
+                break;
+            if(end > begin + 1)
+                components.push_back(filePath.substr(begin + 1, end - begin - 1));
+            begin = end;
+        }
+        
+        // The domains in the path, in the order of config file
+        vector<unsigned> domains;
+        for(unsigned i = 0; i < components.size(); i++){
+            unordered_map<string, vector<unsigned>>::iterator domain = domainIndex.find(components[i]);
+            if(domain != domainIndex.end())
+                domains.insert(domains.end(), domain->second.begin(), domain->second.end());
+        }
+        sort(domains.begin(), domains.end());
+        
+        // The first project of these domains in the path
+        for(unsigned i = 0; i < domains.size() && result.first < 0; i++){
+            int project = -1;
+            for(unsigned j = 0; j < components.size(); j++){
+                unordered_map<string, unsigned>::iterator it = projectIndex[domains[i]].find(components[j]);
+                if(it != projectIndex[domains[i]].end() && (project < 0 || (int)it->second < project))
+                    project = it->second;
+            }
+            if(project >= 0)
+                result = make_pair(domains[i], project);
+        }
+    }
+    else{
+        // Some name is not a plain component, search the names one by one
+        for(unsigned i = 0; i < domainName.size() && result.first < 0; i++){
+            if(filePath.find("/"+domainName[i]+"/") == string::npos)
+                continue;
+            for(unsigned j = 0; j < projectName[i].size(); j++){
+                if(filePath.find("/"+projectName[i][j]+"/") != string::npos){
+                    result = make_pair(i, j);
+                    break;
+                }
+            }
+        }
+    }
+    
+    matchCache[filePath] = result;
+    return result;
+}
+
 // Print the static members
 void ConfigData::printName(){
     for(unsigned i = 0; i < domainName.size(); i++){
@@ -76,6 +164,31 @@ void ConfigData::printName(){
 
 ConfigData CallData::configData;
 sqlite3* CallData::db;
+FILE* CallData::journal = NULL;
+sqlite3_stmt* CallData::preparedStmt[STMT_NUM];
+unsigned CallData::transactionSize = 10000;
+unsigned CallData::pendingRows = 0;
+bool CallData::inTransaction = false;
+bool CallData::bulkLoad = false;
+bool CallData::pathTable = false;
+bool CallData::incremental = false;
+bool CallData::inTranslationUnit = false;
+vector<string> CallData::dependencies;
+long long CallData::firstRowID[3];
+unordered_map<string, unsigned> CallData::pathIDs;
+unordered_map<string, unsigned> CallData::operandIDs;
+unordered_map<string, unsigned> CallData::logActionMasks;
+vector<CallData::CallCounter> CallData::callCounters;
+unordered_map<string, unsigned> CallData::callCounterIndex;
+vector<CallData::PrebranchCounter> CallData::prebranchCounters;
+unordered_map<string, unsigned> CallData::prebranchCounterIndex;
+vector<CallData::PostbranchCounter> CallData::postbranchCounters;
+unordered_map<string, unsigned> CallData::postbranchCounterIndex;
+
+// Bind a string to the parameter of a prepared statement, the string should live until the step
+static void bindText(sqlite3_stmt* stmt, int index, const string& value){
+    sqlite3_bind_text(stmt, index, value.data(), value.size(), SQLITE_STATIC);
+}
 
 // Open the SQLite database
 void CallData::openDatabase(string file){
@@ -92,62 +205,531 @@ void CallData::openDatabase(string file){
     }
     
     sqlite3_busy_timeout(db, 10*1000); // wait for 10s when the database is locked
+    
+    // Set up the schema once, in bulk-load mode the indexes are built when closing the database
+    createTables();
+    if(bulkLoad)
+        dropIndexes();
+    else
+        createIndexes();
 }
 
 // Close the SQLite database
 void CallData::closeDatabase(){
+    if(bulkLoad){
+        commitBatch(true);
+        createIndexes();
+    }
+    flushCounters(true);
+    commitBatch(true);
+    finalizeStatements();
     sqlite3_close(db);
 }
 
+// Load the rows in bulk, the indexes and counters are written after ingestion
+void CallData::setBulkLoad(bool enable){
+    bulkLoad = enable;
+}
+
+// Store the file paths in table file_path, and refer to them by ID in other tables
+void CallData::setPathTable(bool enable){
+    pathTable = enable;
+}
+
+// Get the ID of a string in a table of unique strings, add the string if it is new
+unsigned CallData::getStringID(const string& str, unordered_map<string, unsigned>& IDs, StmtID insertID, const char* insertSQL, StmtID selectID, const char* selectSQL){
+    
+    unordered_map<string, unsigned>::iterator it = IDs.find(str);
+    if(it != IDs.end())
+        return it->second;
+    
+    beginBatch();
+    
+    unsigned ID = 0;
+    sqlite3_stmt* insertStmt = getStatement(insertID, insertSQL);
+    sqlite3_stmt* selectStmt = getStatement(selectID, selectSQL);
+    if(insertStmt && selectStmt){
+        bindText(insertStmt, 1, str);
+        execStatement(insertStmt);
+        bindText(selectStmt, 1, str);
+        ID = selectStatement(selectStmt).first;
+    }
+    IDs[str] = ID;
+    return ID;
+}
+
+// Get the ID of a file path in table file_path, add the path if it is new
+unsigned CallData::getPathID(const string& path){
+    return getStringID(path, pathIDs, STMT_INSERT_FILE_PATH, "insert or ignore into file_path (Path) values (?)", STMT_SELECT_FILE_PATH, "select ID from file_path where Path = ?");
+}
+
+// Get the ID of an operand of branch conditions in table expr_operand, add the operand if it is new
+unsigned CallData::getOperandID(const string& operand){
+    return getStringID(operand, operandIDs, STMT_INSERT_EXPR_OPERAND, "insert or ignore into expr_operand (Operand) values (?)", STMT_SELECT_EXPR_OPERAND, "select ID from expr_operand where Operand = ?");
+}
+
+// Get the actions a post-branch function stands for, each unique name is classified once
+unsigned CallData::getLogActionMask(const string& logName){
+    
+    unordered_map<string, unsigned>::iterator it = logActionMasks.find(logName);
+    if(it != logActionMasks.end())
+        return it->second;
+    
+    unsigned mask = ActionSummary::getNameMask(logName.c_str());
+    logActionMasks[logName] = mask;
+    return mask;
+}
+
+// Get the length of the file path in a location, i.e., without the ":line:column" suffix
+static size_t getPathLength(const string& loc){
+    size_t pos = loc.size();
+    for(int colons = 0; colons < 2; colons++){
+        size_t digits = pos;
+        while(digits > 0 && isdigit(loc[digits - 1]))
+            digits--;
+        if(digits == pos || digits == 0 || loc[digits - 1] != ':')
+            return loc.size();
+        pos = digits - 1;
+    }
+    return pos;
+}
+
+// Replace the path of a location ("path" or "path:line:column") by its ID in
+// table file_path, when the path table is enabled
+string CallData::encodeLoc(const string& loc){
+    
+    if(!pathTable || loc == "-")
+        return loc;
+    
+    size_t pos = getPathLength(loc);
+    return std::to_string(getPathID(loc.substr(0, pos))) + loc.substr(pos);
+}
+
+// Execute a sql stmt which returns no row
+bool CallData::execSQL(string stmt){
+    char *zErrMsg = 0;
+    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
+    int rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
+    if(rc!=SQLITE_OK){
+        cerr<<stmt<<endl;
+        fprintf(stderr, "SQL error: %s\n", zErrMsg);
+        sqlite3_free(zErrMsg);
+        return false;
+    }
+    return true;
+}
+
+// Create the tables if not exist
+void CallData::createTables(){
+    execSQL("create table if not exists branch_call (ID integer primary key autoincrement, DomainName text, ProjectName text, CallName text, CallDefLoc text, CallID text, CallStr text, CallReturn text, CallArgVec text, CallArgNum text, ExprNodeVec text, ExprNodeNum text, ExprStrVec text, PathNumberVec text, CaseLabelVec text, BranchLevel text, LogName text, LogDefLoc text, LogID text, LogStr text, LogArgVec text, LogArgNum text, LogRetType text, LogArgTypeVec text, LogArgTypeNum text, ExprNodeCode blob, LogActionMask integer)");
+    execSQL("create table if not exists prebranch_call (ID integer primary key autoincrement, CallName text, CallDefLoc text, DomainName text, ProjectName text, LogName text, LogDefLoc text, NumLogTime integer)");
+    execSQL("create table if not exists postbranch_call (ID integer primary key autoincrement, LogName text, LogDefLoc text, DomainName text, ProjectName text, PrebranchCall text, NumPrebranchCall integer, NumPostbranchCall integer)");
+    execSQL("create table if not exists call_graph (ID integer primary key autoincrement, FuncName text, FuncDefLoc text, FuncSize integer, DomainName text, ProjectName text, CallName text, CallDefLoc text)");
+    execSQL("create table if not exists function_call (ID integer primary key autoincrement, CallName text, CallDefLoc text, DomainName text, ProjectName text, CallID text, CallStr text)");
+    execSQL("create table if not exists call_statistic (ID integer primary key autoincrement, CallName text, CallDefLoc text, DomainName text, ProjectName text, CallNumber integer)");
+    execSQL("create table if not exists expr_operand (ID integer primary key autoincrement, Operand text unique)");
+    execSQL("create table if not exists function_summary (ID integer primary key autoincrement, FuncName text, FuncDefLoc text, ActionMask integer, ExitLevel integer, OutputLevel integer, FreeLevel integer, DeleteLevel integer, CloseLevel integer, ReturnLevel integer, GotoLevel integer, BreakLevel integer, ContinueLevel integer)");
+    
+    // The databases created before ExprNodeCode and LogActionMask have no such columns
+    sqlite3_stmt* columnStmt;
+    if(sqlite3_prepare_v2(db, "select ExprNodeCode from branch_call limit 0", -1, &columnStmt, NULL) == SQLITE_OK)
+        sqlite3_finalize(columnStmt);
+    else
+        execSQL("alter table branch_call add column ExprNodeCode blob");
+    if(sqlite3_prepare_v2(db, "select LogActionMask from branch_call limit 0", -1, &columnStmt, NULL) == SQLITE_OK)
+        sqlite3_finalize(columnStmt);
+    else
+        execSQL("alter table branch_call add column LogActionMask integer");
+    
+    if(pathTable)
+        execSQL("create table if not exists file_path (ID integer primary key autoincrement, Path text unique)");
+    if(incremental)
+        execSQL("create table if not exists tu_cache (ID integer primary key autoincrement, SourceFile text unique, Hash text, Dependencies text, BranchCallFirst integer, BranchCallLast integer, FunctionCallFirst integer, FunctionCallLast integer, CallGraphFirst integer, CallGraphLast integer)");
+}
+
+// Create the indexes if not exist
+void CallData::createIndexes(){
+    execSQL("CREATE INDEX IF NOT EXISTS call1_index ON branch_call(CallName, CallDefLoc)");
+    execSQL("CREATE INDEX IF NOT EXISTS call2_index ON prebranch_call(CallName, CallDefLoc)");
+    execSQL("CREATE INDEX IF NOT EXISTS log_index ON postbranch_call(LogName, LogDefLoc)");
+    execSQL("CREATE INDEX IF NOT EXISTS func_index ON call_graph(FuncName, FuncDefLoc)");
+    execSQL("CREATE INDEX IF NOT EXISTS call4_index ON function_call(CallName, CallDefLoc)");
+    execSQL("CREATE INDEX IF NOT EXISTS call3_index ON call_statistic(CallName, CallDefLoc)");
+    execSQL("CREATE INDEX IF NOT EXISTS summary_index ON function_summary(FuncName, FuncDefLoc)");
+}
+
+// Drop the indexes, so that inserting rows doesn't pay for maintaining them
+void CallData::dropIndexes(){
+    execSQL("DROP INDEX IF EXISTS call1_index");
+    execSQL("DROP INDEX IF EXISTS call2_index");
+    execSQL("DROP INDEX IF EXISTS log_index");
+    execSQL("DROP INDEX IF EXISTS func_index");
+    execSQL("DROP INDEX IF EXISTS call4_index");
+    execSQL("DROP INDEX IF EXISTS call3_index");
+    execSQL("DROP INDEX IF EXISTS summary_index");
+}
+
 // Get the SQLite database
 sqlite3* CallData::getDatabase(){
     return db;
 }
 
-string& replace_all_distinct(string& str,const string& old_value, const string& new_value)
-{
-    string::size_type pos = 0;
-    while ( (pos = str.find(old_value, pos)) != string::npos ) {
-        str.replace( pos, old_value.size(), new_value );
-        pos+=new_value.size();
+// Operation codes of the journal file
+#define JOURNAL_BRANCH_CALL     'B'
+#define JOURNAL_PREBRANCH_CALL  'R'
+#define JOURNAL_POSTBRANCH_CALL 'O'
+#define JOURNAL_CALL_GRAPH      'G'
+#define JOURNAL_FUNCTION_CALL   'F'
+#define JOURNAL_DEPENDENCY      'D'
+#define JOURNAL_FILE_STATS      'S'
+
+// Write a length-prefixed string to the journal
+static void writeString(FILE* file, const string& str){
+    unsigned len = str.size();
+    fwrite(&len, sizeof(len), 1, file);
+    fwrite(str.data(), 1, len, file);
+}
+
+// Write a string vector to the journal
+static void writeStringVec(FILE* file, const vector<string>& vec){
+    unsigned num = vec.size();
+    fwrite(&num, sizeof(num), 1, file);
+    for(unsigned i = 0; i < num; i++)
+        writeString(file, vec[i]);
+}
+
+// Write an int vector to the journal
+static void writeIntVec(FILE* file, const vector<int>& vec){
+    unsigned num = vec.size();
+    fwrite(&num, sizeof(num), 1, file);
+    if(num)
+        fwrite(&vec[0], sizeof(int), num, file);
+}
+
+// Read a length-prefixed string from the journal
+static bool readString(FILE* file, string& str){
+    unsigned len;
+    if(fread(&len, sizeof(len), 1, file) != 1)
+        return false;
+    str.resize(len);
+    if(len && fread(&str[0], 1, len, file) != len)
+        return false;
+    return true;
+}
+
+// Read a string vector from the journal
+static bool readStringVec(FILE* file, vector<string>& vec){
+    unsigned num;
+    if(fread(&num, sizeof(num), 1, file) != 1)
+        return false;
+    vec.resize(num);
+    for(unsigned i = 0; i < num; i++)
+        if(!readString(file, vec[i]))
+            return false;
+    return true;
+}
+
+// Read an int vector from the journal
+static bool readIntVec(FILE* file, vector<int>& vec){
+    unsigned num;
+    if(fread(&num, sizeof(num), 1, file) != 1)
+        return false;
+    vec.resize(num);
+    if(num && fread(&vec[0], sizeof(int), num, file) != num)
+        return false;
+    return true;
+}
+
+// Journal the following add* operations to a file instead of the database
+bool CallData::startJournal(string journalFile){
+    journal = fopen(journalFile.c_str(), "wb");
+    if(journal == NULL){
+        fprintf(stderr, "Can't open journal file: %s\n", journalFile.c_str());
+        return false;
     }
-    return str;
+    return true;
 }
 
-// Callback function to get the selected data in  SQLite
-static int cb_get_info(void *data, int argc, char **argv, char **azColName){
+// Stop journaling and flush the journal file
+void CallData::stopJournal(){
+    if(journal){
+        fclose(journal);
+        journal = NULL;
+    }
+}
+
+// Replay the add* operations recorded in a journal file
+bool CallData::replayJournal(string journalFile){
     
-    pair<int, vector<string>>* rowdata = (pair<int, vector<string>>*) data;
+    FILE* file = fopen(journalFile.c_str(), "rb");
+    if(file == NULL){
+        fprintf(stderr, "Can't open journal file: %s\n", journalFile.c_str());
+        return false;
+    }
     
-    // Multiple rows have the same function name, which should not happen.
-    if(rowdata->first != 0){
-        fprintf(stderr, "Multiple rows have the same function name\n");
-        return SQLITE_ERROR;
+    bool ok = true;
+    int op;
+    while(ok && (op = fgetc(file)) != EOF){
+        switch(op){
+            case JOURNAL_BRANCH_CALL:{
+                BranchInfo branchInfo;
+                ok = readString(file, branchInfo.callName) &&
+                     readString(file, branchInfo.callDefLoc) &&
+                     readString(file, branchInfo.callID) &&
+                     readString(file, branchInfo.callStr) &&
+                     readStringVec(file, branchInfo.callReturnVec) &&
+                     readStringVec(file, branchInfo.callArgVec) &&
+                     readStringVec(file, branchInfo.exprNodeVec) &&
+                     readStringVec(file, branchInfo.exprStrVec) &&
+                     readStringVec(file, branchInfo.caseLabelVec) &&
+                     readIntVec(file, branchInfo.pathNumberVec) &&
+                     readString(file, branchInfo.logName) &&
+                     readString(file, branchInfo.logDefLoc) &&
+                     readString(file, branchInfo.logID) &&
+                     readString(file, branchInfo.logStr) &&
+                     readStringVec(file, branchInfo.logArgVec) &&
+                     readString(file, branchInfo.logRetType) &&
+                     readStringVec(file, branchInfo.logArgTypeVec);
+                if(ok)
+                    addBranchCall(branchInfo);
+                break;
+            }
+            case JOURNAL_PREBRANCH_CALL:
+            case JOURNAL_POSTBRANCH_CALL:{
+                string callName, callLocFullPath, callDefFullPath, logName, logDefFullPath;
+                ok = readString(file, callName) &&
+                     readString(file, callLocFullPath) &&
+                     readString(file, callDefFullPath) &&
+                     readString(file, logName) &&
+                     readString(file, logDefFullPath);
+                if(ok && op == JOURNAL_PREBRANCH_CALL)
+                    addPrebranchCall(callName, callLocFullPath, callDefFullPath, logName, logDefFullPath);
+                if(ok && op == JOURNAL_POSTBRANCH_CALL)
+                    addPostbranchCall(callName, callLocFullPath, callDefFullPath, logName, logDefFullPath);
+                break;
+            }
+            case JOURNAL_CALL_GRAPH:{
+                string funcName, funcDefFullPath, callName, callDefFullPath, callLocFullPath;
+                unsigned funcSize;
+                ok = readString(file, funcName) &&
+                     readString(file, funcDefFullPath) &&
+                     readString(file, callName) &&
+                     readString(file, callDefFullPath) &&
+                     readString(file, callLocFullPath) &&
+                     fread(&funcSize, sizeof(funcSize), 1, file) == 1;
+                if(ok)
+                    addCallGraph(funcName, funcDefFullPath, callName, callDefFullPath, callLocFullPath, funcSize);
+                break;
+            }
+            case JOURNAL_FUNCTION_CALL:{
+                string callName, callLocFullPath, callDefFullPath, callStr;
+                ok = readString(file, callName) &&
+                     readString(file, callLocFullPath) &&
+                     readString(file, callDefFullPath) &&
+                     readString(file, callStr);
+                if(ok)
+                    addFunctionCall(callName, callLocFullPath, callDefFullPath, callStr);
+                break;
+            }
+            case JOURNAL_DEPENDENCY:{
+                string fileFullPath;
+                ok = readString(file, fileFullPath);
+                if(ok)
+                    addDependency(fileFullPath);
+                break;
+            }
+            case JOURNAL_FILE_STATS:{
+                RunStats::FileStats fileStats;
+                ok = readString(file, fileStats.file) &&
+                     fread(fileStats.wallTime, sizeof(double), RunStats::PHASE_NUM, file) == RunStats::PHASE_NUM &&
+                     fread(fileStats.cpuTime, sizeof(double), RunStats::PHASE_NUM, file) == RunStats::PHASE_NUM &&
+                     fread(fileStats.rows, sizeof(unsigned long long), RunStats::TABLE_NUM, file) == RunStats::TABLE_NUM;
+                if(ok)
+                    addFileStats(fileStats);
+                break;
+            }
+            default:
+                ok = false;
+        }
     }
     
-    // Print the row
-    //int i;
-    //printf("Selected: ");
-    //for(i=0; i<argc; i++){
-    //    printf("%s = %s\n", azColName[i], argv[i] ? argv[i] : "NULL");
-    //}
-    //printf("\n");
+    if(!ok)
+        fprintf(stderr, "Broken journal file: %s\n", journalFile.c_str());
+    fclose(file);
+    return ok;
+}
+
+// Add the profile of a source file, a worker journals it for the parent
+void CallData::addFileStats(const RunStats::FileStats& fileStats){
+    
+    // Record the operation when running as a worker
+    if(journal){
+        fputc(JOURNAL_FILE_STATS, journal);
+        writeString(journal, fileStats.file);
+        fwrite(fileStats.wallTime, sizeof(double), RunStats::PHASE_NUM, journal);
+        fwrite(fileStats.cpuTime, sizeof(double), RunStats::PHASE_NUM, journal);
+        fwrite(fileStats.rows, sizeof(unsigned long long), RunStats::TABLE_NUM, journal);
+        return;
+    }
+    
+    RunStats::mergeFile(fileStats);
+}
+
+// Set the number of rows written in one transaction
+void CallData::setTransactionSize(unsigned size){
+    transactionSize = size;
+}
+
+// Begin a transaction if rows are committed in batch and no transaction is open
+void CallData::beginBatch(){
+    if(transactionSize == 0 || inTransaction)
+        return;
+    
+    char *zErrMsg = 0;
+    int rc = sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, &zErrMsg);
+    if(rc!=SQLITE_OK){
+        fprintf(stderr, "SQL error: %s\n", zErrMsg);
+        sqlite3_free(zErrMsg);
+        return;
+    }
+    inTransaction = true;
+    pendingRows = 0;
+}
+
+// Count a written row, and commit the transaction when the batch is full or force is set
+void CallData::commitBatch(bool force){
+    if(!inTransaction)
+        return;
+    
+    // The rows of a translation unit are committed together in incremental mode
+    if(!force && (inTranslationUnit || ++pendingRows < transactionSize))
+        return;
+    
+    char *zErrMsg = 0;
+    int rc = sqlite3_exec(db, "COMMIT TRANSACTION", 0, 0, &zErrMsg);
+    if(rc!=SQLITE_OK){
+        fprintf(stderr, "SQL error: %s\n", zErrMsg);
+        sqlite3_free(zErrMsg);
+        return;
+    }
+    inTransaction = false;
+    pendingRows = 0;
+}
+
+// Get the cached prepared statement, prepare it at the first time
+sqlite3_stmt* CallData::getStatement(StmtID id, const char* sql){
+    
+    if(preparedStmt[id]){
+        sqlite3_reset(preparedStmt[id]);
+        sqlite3_clear_bindings(preparedStmt[id]);
+        return preparedStmt[id];
+    }
     
-    // Get the values
-    vector<string> values;
-    for(int i = 0; i < argc; i++){
-        string value = argv[i];
-        values.push_back(value);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &preparedStmt[id], NULL);
+    if(rc!=SQLITE_OK){
+        cerr<<sql<<endl;
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        sqlite3_finalize(preparedStmt[id]);
+        preparedStmt[id] = NULL;
+    }
+    return preparedStmt[id];
+}
+
+// Finalize all the cached prepared statements
+void CallData::finalizeStatements(){
+    for(unsigned i = 0; i < STMT_NUM; i++){
+        sqlite3_finalize(preparedStmt[i]);
+        preparedStmt[i] = NULL;
+    }
+}
+
+// Step a prepared statement which returns no row
+bool CallData::execStatement(sqlite3_stmt* stmt){
+    if(OUTPUT_SQL_STMT)cerr<<sqlite3_sql(stmt)<<endl;
+    int rc = sqlite3_step(stmt);
+    if(rc!=SQLITE_DONE){
+        cerr<<sqlite3_sql(stmt)<<endl;
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
     }
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE;
+}
+
+// Step a prepared statement which selects at most one row, and get the ID and values of the row.
+// The ID is 0 if there is no such row.
+pair<int, vector<string>> CallData::selectStatement(sqlite3_stmt* stmt){
     
-    // Store the ID and values
-    *rowdata = make_pair(atoi(argv[0]), values);
-    return SQLITE_OK;
+    pair<int, vector<string>> rowdata = make_pair(0, vector<string>());
+    
+    if(OUTPUT_SQL_STMT)cerr<<sqlite3_sql(stmt)<<endl;
+    int rc = sqlite3_step(stmt);
+    if(rc == SQLITE_ROW){
+        for(int i = 0; i < sqlite3_column_count(stmt); i++){
+            const char* value = (const char*) sqlite3_column_text(stmt, i);
+            rowdata.second.push_back(value ? value : "");
+        }
+        rowdata.first = sqlite3_column_int(stmt, 0);
+        
+        // Multiple rows have the same function name, which should not happen.
+        rc = sqlite3_step(stmt);
+        if(rc == SQLITE_ROW)
+            fprintf(stderr, "Multiple rows have the same function name\n");
+    }
+    if(rc != SQLITE_DONE && rc != SQLITE_ROW){
+        cerr<<sqlite3_sql(stmt)<<endl;
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+    }
+    sqlite3_reset(stmt);
+    return rowdata;
+}
+
+// Append a part to the key of a counter
+static void appendKey(string& key, const string& part){
+    key += part;
+    key += '\0';
+}
+
+// Join the vector by "#-_-#", and use "-" for an empty string
+static string joinVec(const vector<string>& vec){
+    string str;
+    for(unsigned i = 0; i < vec.size(); i++){
+        str += vec[i];
+        if(i != vec.size() - 1)
+            str += "#-_-#";
+    }
+    if(str == "")
+        str = "-";
+    return str;
 }
 
 // Add a branch call
 void CallData::addBranchCall(BranchInfo branchInfo){
     
+    // Record the operation when running as a worker
+    if(journal){
+        fputc(JOURNAL_BRANCH_CALL, journal);
+        writeString(journal, branchInfo.callName);
+        writeString(journal, branchInfo.callDefLoc);
+        writeString(journal, branchInfo.callID);
+        writeString(journal, branchInfo.callStr);
+        writeStringVec(journal, branchInfo.callReturnVec);
+        writeStringVec(journal, branchInfo.callArgVec);
+        writeStringVec(journal, branchInfo.exprNodeVec);
+        writeStringVec(journal, branchInfo.exprStrVec);
+        writeStringVec(journal, branchInfo.caseLabelVec);
+        writeIntVec(journal, branchInfo.pathNumberVec);
+        writeString(journal, branchInfo.logName);
+        writeString(journal, branchInfo.logDefLoc);
+        writeString(journal, branchInfo.logID);
+        writeString(journal, branchInfo.logStr);
+        writeStringVec(journal, branchInfo.logArgVec);
+        writeString(journal, branchInfo.logRetType);
+        writeStringVec(journal, branchInfo.logArgTypeVec);
+        return;
+    }
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
     // Get the domain name and project name from given path
     pair<string, string> mDomProName = getDomainProjectName(branchInfo.callID);
     string domainName = mDomProName.first;
@@ -156,57 +738,24 @@ void CallData::addBranchCall(BranchInfo branchInfo){
         return;
     }
     
-    // Prepare the sql stmt to create the table
-    int rc;
-    char *zErrMsg = 0;
-    string stmt = "create table if not exists branch_call (ID integer primary key autoincrement, DomainName text, ProjectName text, CallName text, CallDefLoc text, CallID text, CallStr text, CallReturn text, CallArgVec text, CallArgNum text, ExprNodeVec text, ExprNodeNum text, ExprStrVec text, PathNumberVec text, CaseLabelVec text, BranchLevel text, LogName text, LogDefLoc text, LogID text, LogStr text, LogArgVec text, LogArgNum text, LogRetType text, LogArgTypeVec text, LogArgTypeNum text)";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
-    else
-        rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS call1_index ON branch_call(CallName, CallDefLoc)", 0, 0, &zErrMsg);
+    // Refer to the files by ID when the path table is enabled
+    branchInfo.callDefLoc = encodeLoc(branchInfo.callDefLoc);
+    branchInfo.callID = encodeLoc(branchInfo.callID);
+    branchInfo.logDefLoc = encodeLoc(branchInfo.logDefLoc);
+    branchInfo.logID = encodeLoc(branchInfo.logID);
     
-    // Prepare the sql stmt to insert new entry
-    string callReturnVecStr;
-    for(unsigned i = 0; i < branchInfo.callReturnVec.size(); i++){
-        callReturnVecStr += branchInfo.callReturnVec[i];
-        if(i != branchInfo.callReturnVec.size() - 1)
-            callReturnVecStr += "#-_-#";
-    }
-    if(callReturnVecStr == "")
-        callReturnVecStr = "-";
-    
-    string callArgVecStr;
-    for(unsigned i = 0; i < branchInfo.callArgVec.size(); i++){
-        callArgVecStr += branchInfo.callArgVec[i];
-        if(i != branchInfo.callArgVec.size() - 1)
-            callArgVecStr += "#-_-#";
-    }
-    if(callArgVecStr == "")
-        callArgVecStr = "-";
-    
-    string exprNodeVecStr;
-    for(unsigned i = 0; i < branchInfo.exprNodeVec.size(); i++){
-        exprNodeVecStr += branchInfo.exprNodeVec[i];
-        if(i != branchInfo.exprNodeVec.size() - 1)
-            exprNodeVecStr += "#-_-#";
-    }
-    if(exprNodeVecStr == "")
-        exprNodeVecStr = "-";
-    
-    string logArgVecStr;
-    for(unsigned i = 0; i < branchInfo.logArgVec.size(); i++){
-        logArgVecStr += branchInfo.logArgVec[i];
-        if(i != branchInfo.logArgVec.size() - 1)
-            logArgVecStr += "#-_-#";
-    }
-    if(logArgVecStr == "")
-        logArgVecStr = "-";
     
+    // Prepare the values of the new entry
+    string callReturnVecStr = joinVec(branchInfo.callReturnVec);
+    string callArgVecStr = joinVec(branchInfo.callArgVec);
+    string exprNodeVecStr = joinVec(branchInfo.exprNodeVec);
+    string exprNodeCode = ExprCode::encode(branchInfo.exprNodeVec, [this](const string& operand){ return getOperandID(operand); });
+    string logArgVecStr = joinVec(branchInfo.logArgVec);
+    string exprStrVecStr = joinVec(branchInfo.exprStrVec);
+    string caseLabelVecStr = joinVec(branchInfo.caseLabelVec);
+    
+    // Keep the legacy format, which puts no separator after the last arg type
+    // only when the numbers of arg types and args are the same
     string logArgTypeVecStr;
     for(unsigned i = 0; i < branchInfo.logArgTypeVec.size(); i++){
         logArgTypeVecStr += branchInfo.logArgTypeVec[i];
@@ -216,15 +765,6 @@ void CallData::addBranchCall(BranchInfo branchInfo){
     if(logArgTypeVecStr == "")
         logArgTypeVecStr = "-";
     
-    string exprStrVecStr;
-    for(unsigned i = 0; i < branchInfo.exprStrVec.size(); i++){
-        exprStrVecStr += branchInfo.exprStrVec[i];
-        if(i != branchInfo.exprStrVec.size() - 1)
-            exprStrVecStr += "#-_-#";
-    }
-    if(exprStrVecStr == "")
-        exprStrVecStr = "-";
-    
     string pathNumberVecStr;
     for(unsigned i = 0; i < branchInfo.pathNumberVec.size(); i++){
         char pathNumber[10];
@@ -236,15 +776,6 @@ void CallData::addBranchCall(BranchInfo branchInfo){
     if(pathNumberVecStr == "")
         pathNumberVecStr = "-";
     
-    string caseLabelVecStr;
-    for(unsigned i = 0; i < branchInfo.caseLabelVec.size(); i++){
-        caseLabelVecStr += branchInfo.caseLabelVec[i];
-        if(i != branchInfo.caseLabelVec.size() - 1)
-            caseLabelVecStr += "#-_-#";
-    }
-    if(caseLabelVecStr == "")
-        caseLabelVecStr = "-";
-    
     char callArgNumStr[10];
     char exprNodeNumStr[10];
     char branchLevelStr[10];
@@ -256,25 +787,41 @@ void CallData::addBranchCall(BranchInfo branchInfo){
     sprintf(logArgNumStr, "%lu", branchInfo.logArgVec.size());
     sprintf(logArgTypeNumStr, "%lu", branchInfo.logArgTypeVec.size());
     
-    // Replace "'" by "''" to make sqlite happy
-    branchInfo.callStr = replace_all_distinct(branchInfo.callStr, "'", "''");
-    callReturnVecStr = replace_all_distinct(callReturnVecStr, "'", "''");
-    callArgVecStr = replace_all_distinct(callArgVecStr, "'", "''");
-    exprNodeVecStr = replace_all_distinct(exprNodeVecStr, "'", "''");
-    exprStrVecStr = replace_all_distinct(exprStrVecStr, "'", "''");
-    caseLabelVecStr = replace_all_distinct(caseLabelVecStr, "'", "''");
-    branchInfo.logStr = replace_all_distinct(branchInfo.logStr, "'", "''");
-    logArgVecStr = replace_all_distinct(logArgVecStr, "'", "''");
-    
-    stmt = "insert into branch_call (DomainName, ProjectName, CallName, CallDefLoc, CallID, CallStr, CallReturn, CallArgVec, CallArgNum, ExprNodeVec, ExprNodeNum, ExprStrVec, PathNumberVec, CaseLabelVec, BranchLevel, LogName, LogDefLoc, LogID, LogStr, LogArgVec, LogArgNum, LogRetType, LogArgTypeVec, LogArgTypeNum) values ('" + domainName + "', '" + projectName + "', '" + branchInfo.callName + "', '" + branchInfo.callDefLoc + "', '" + branchInfo.callID + "', '" + branchInfo.callStr + "', '" + callReturnVecStr + "', '" + callArgVecStr + "', '" + callArgNumStr + "', '" + exprNodeVecStr + "', '" + exprNodeNumStr + "', '" + exprStrVecStr + "', '" + pathNumberVecStr + "', '" + caseLabelVecStr + "', '" + branchLevelStr + "', '" + branchInfo.logName + "', '" + branchInfo.logDefLoc + "', '" + branchInfo.logID + "', '" + branchInfo.logStr + "', '" + logArgVecStr + "', '" + logArgNumStr + "', '" + branchInfo.logRetType + "', '" + logArgTypeVecStr + "', '" + logArgTypeNumStr +"')";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    //cerr<<stmt<<endl;     // for debug
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
+    // Insert the new entry, the values are bound so that no escaping is needed
+    sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_BRANCH_CALL, "insert into branch_call (DomainName, ProjectName, CallName, CallDefLoc, CallID, CallStr, CallReturn, CallArgVec, CallArgNum, ExprNodeVec, ExprNodeNum, ExprStrVec, PathNumberVec, CaseLabelVec, BranchLevel, LogName, LogDefLoc, LogID, LogStr, LogArgVec, LogArgNum, LogRetType, LogArgTypeVec, LogArgTypeNum, ExprNodeCode, LogActionMask) values (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    if(!insertStmt)
+        return;
+    bindText(insertStmt, 1, domainName);
+    bindText(insertStmt, 2, projectName);
+    bindText(insertStmt, 3, branchInfo.callName);
+    bindText(insertStmt, 4, branchInfo.callDefLoc);
+    bindText(insertStmt, 5, branchInfo.callID);
+    bindText(insertStmt, 6, branchInfo.callStr);
+    bindText(insertStmt, 7, callReturnVecStr);
+    bindText(insertStmt, 8, callArgVecStr);
+    bindText(insertStmt, 9, callArgNumStr);
+    bindText(insertStmt, 10, exprNodeVecStr);
+    bindText(insertStmt, 11, exprNodeNumStr);
+    bindText(insertStmt, 12, exprStrVecStr);
+    bindText(insertStmt, 13, pathNumberVecStr);
+    bindText(insertStmt, 14, caseLabelVecStr);
+    bindText(insertStmt, 15, branchLevelStr);
+    bindText(insertStmt, 16, branchInfo.logName);
+    bindText(insertStmt, 17, branchInfo.logDefLoc);
+    bindText(insertStmt, 18, branchInfo.logID);
+    bindText(insertStmt, 19, branchInfo.logStr);
+    bindText(insertStmt, 20, logArgVecStr);
+    bindText(insertStmt, 21, logArgNumStr);
+    bindText(insertStmt, 22, branchInfo.logRetType);
+    bindText(insertStmt, 23, logArgTypeVecStr);
+    bindText(insertStmt, 24, logArgTypeNumStr);
+    sqlite3_bind_blob(insertStmt, 25, exprNodeCode.data(), exprNodeCode.size(), SQLITE_STATIC);
+    sqlite3_bind_int(insertStmt, 26, getLogActionMask(branchInfo.logName));
+    
+    beginBatch();
+    if(execStatement(insertStmt))
+        RunStats::addRow(RunStats::TABLE_BRANCH_CALL);
+    commitBatch(false);
     
     return;
 }
@@ -282,6 +829,19 @@ void CallData::addBranchCall(BranchInfo branchInfo){
 // Add a pre-branch call
 void CallData::addPrebranchCall(string callName, string callLocFullPath, string callDefFullPath, string logName, string logDefFullPath){
     
+    // Record the operation when running as a worker
+    if(journal){
+        fputc(JOURNAL_PREBRANCH_CALL, journal);
+        writeString(journal, callName);
+        writeString(journal, callLocFullPath);
+        writeString(journal, callDefFullPath);
+        writeString(journal, logName);
+        writeString(journal, logDefFullPath);
+        return;
+    }
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
     // Get the domain name and project name from given path
     pair<string, string> mDomProName = getDomainProjectName(callLocFullPath);
     string domainName = mDomProName.first;
@@ -290,75 +850,53 @@ void CallData::addPrebranchCall(string callName, string callLocFullPath, string
         return;
     }
     
-    // Prepare the sql stmt to create the table
-    int rc;
-    char *zErrMsg = 0;
-    string stmt = "create table if not exists prebranch_call (ID integer primary key autoincrement, CallName text, CallDefLoc text, DomainName text, ProjectName text, LogName text, LogDefLoc text, NumLogTime integer)";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
-    else
-        rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS call2_index ON prebranch_call(CallName, CallDefLoc)", 0, 0, &zErrMsg);
-    
-    // Check whether the function is called the first time
-    int ID = 0;
-    vector<string> values;
-    values.clear();
-    // Store ID and values for the each row
-    pair<int, vector<string>> rowdata = make_pair(ID, values);
-    stmt="select * from prebranch_call where LogName = '" + logName + "' and LogDefLoc = '" + logDefFullPath + "' and CallName = '" + callName + "' and CallDefLoc = '" + callDefFullPath + "' and DomainName = '" + domainName + "' and ProjectName = '" + projectName + "'";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), cb_get_info, &rowdata, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
+    // Refer to the files by ID when the path table is enabled
+    callDefFullPath = encodeLoc(callDefFullPath);
+    logDefFullPath = encodeLoc(logDefFullPath);
     
-    // The function is called the first time
-    if(rowdata.first == 0){
-        
-        // Prepare the sql stmt to insert new entry
-        stmt = "insert into prebranch_call (CallName, CallDefLoc, DomainName, ProjectName, LogName, LogDefLoc, NumLogTime) values ('" + callName + "', '" + callDefFullPath + "', '" + domainName + "', '" + projectName + "', '" + logName + "', '" + logDefFullPath + "', 1)";
-        if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-        rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-        if(rc!=SQLITE_OK){
-            cerr<<stmt<<endl;
-            fprintf(stderr, "SQL error: %s\n", zErrMsg);
-            sqlite3_free(zErrMsg);
-        }
-    }
-    else{
-        // Prepare the sql stmt to update the entry
-        //get old value
-        int numLogTime =  atoi(rowdata.second[7].c_str());
-        //get new value
-        numLogTime++;
-        //convert from int to char*
-        char numLogTimeStr[10];
-        sprintf(numLogTimeStr, "%d", numLogTime);
-        string numLogTimeString = numLogTimeStr;
-        //combine whole sql statement
-        stmt = "update prebranch_call set NumLogTime = " + numLogTimeString + " where LogName = '" + logName + "' and LogDefLoc = '" + logDefFullPath + "' and CallName = '" + callName + "' and CallDefLoc = '" + callDefFullPath + "' and DomainName = '" + domainName + "' and ProjectName = '" + projectName + "'";
-        if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-        //execute the update stmt
-        rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-        if(rc!=SQLITE_OK){
-            cerr<<stmt<<endl;
-            fprintf(stderr, "SQL error: %s\n", zErrMsg);
-            sqlite3_free(zErrMsg);
-        }
+    
+    // Count the pre-branch call in memory, the counter is written by flushCounters
+    string key;
+    appendKey(key, callName);
+    appendKey(key, callDefFullPath);
+    appendKey(key, domainName);
+    appendKey(key, projectName);
+    appendKey(key, logName);
+    appendKey(key, logDefFullPath);
+    unordered_map<string, unsigned>::iterator it = prebranchCounterIndex.find(key);
+    if(it == prebranchCounterIndex.end()){
+        PrebranchCounter counter;
+        counter.callName = callName;
+        counter.callDefLoc = callDefFullPath;
+        counter.domainName = domainName;
+        counter.projectName = projectName;
+        counter.logName = logName;
+        counter.logDefLoc = logDefFullPath;
+        counter.numLogTime = 0;
+        it = prebranchCounterIndex.insert(make_pair(key, prebranchCounters.size())).first;
+        prebranchCounters.push_back(counter);
     }
+    prebranchCounters[it->second].numLogTime++;
+    RunStats::addRow(RunStats::TABLE_PREBRANCH_CALL);
     return;
 }
 
 // Add a post-branch call
 void CallData::addPostbranchCall(string callName, string callLocFullPath, string callDefFullPath, string logName, string logDefFullPath){
     
+    // Record the operation when running as a worker
+    if(journal){
+        fputc(JOURNAL_POSTBRANCH_CALL, journal);
+        writeString(journal, callName);
+        writeString(journal, callLocFullPath);
+        writeString(journal, callDefFullPath);
+        writeString(journal, logName);
+        writeString(journal, logDefFullPath);
+        return;
+    }
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
     // Get the domain name and project name from given path
     pair<string, string> mDomProName = getDomainProjectName(callLocFullPath);
     string domainName = mDomProName.first;
@@ -367,82 +905,53 @@ void CallData::addPostbranchCall(string callName, string callLocFullPath, string
         return;
     }
     
-    // Prepare the sql stmt to create the table
-    int rc;
-    char *zErrMsg = 0;
-    string stmt = "create table if not exists postbranch_call (ID integer primary key autoincrement, LogName text, LogDefLoc text, DomainName text, ProjectName text, PrebranchCall text, NumPrebranchCall integer, NumPostbranchCall integer)";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
-    else
-        rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS log_index ON postbranch_call(LogName, LogDefLoc)", 0, 0, &zErrMsg);
-
-    // Check whether the function is called the first time
-    int ID = 0;
-    vector<string> values;
-    values.clear();
-    // Store ID and values for the certain row
-    pair<int, vector<string>> rowdata = make_pair(ID, values);
-    stmt="select * from postbranch_call where LogName = '" + logName + "' and LogDefLoc = '" + logDefFullPath + "' and DomainName = '" + domainName + "' and ProjectName = '" + projectName + "'";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), cb_get_info, &rowdata, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
+    // Refer to the files by ID when the path table is enabled
+    callDefFullPath = encodeLoc(callDefFullPath);
+    logDefFullPath = encodeLoc(logDefFullPath);
     
-    // The function is called the first time
-    if(rowdata.first == 0){
-
-        // Prepare the sql stmt to insert new entry
-        stmt = "insert into postbranch_call (LogName, LogDefLoc, DomainName, ProjectName, PrebranchCall, NumPrebranchCall, NumPostbranchCall) values ('" + logName + "', '" + logDefFullPath + "', '" + domainName + "', '" + projectName + "', '#" + callName + "#', 1, 1)";
-        if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-        rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-        if(rc!=SQLITE_OK){
-            cerr<<stmt<<endl;
-            fprintf(stderr, "SQL error: %s\n", zErrMsg);
-            sqlite3_free(zErrMsg);
-        }
-    }
-    else{
-        // Prepare the sql stmt to update the entry
-        //get old value
-        string prebranchCall = rowdata.second[5];
-        int numPrebranchCall =  atoi(rowdata.second[6].c_str());
-        int numPostbranchCall =  atoi(rowdata.second[7].c_str());
-        //get new value
-        if(prebranchCall.find("#" + callName + "#") == string::npos){
-            prebranchCall += callName + "#";
-            numPrebranchCall++;
-        }
-        numPostbranchCall++;
-        //convert from int to char*
-        char numPrebranchCallStr[10];
-        char numPostbranchCallStr[10];
-        sprintf(numPrebranchCallStr, "%d", numPrebranchCall);
-        sprintf(numPostbranchCallStr, "%d", numPostbranchCall);
-        //combine whole sql statement
-        stmt = "update postbranch_call set PrebranchCall = '" + prebranchCall + "', NumPrebranchCall = " + numPrebranchCallStr + ", NumPostbranchCall = " + numPostbranchCallStr + " where LogName = '" + logName + "' and LogDefLoc = '" + logDefFullPath + "' and DomainName = '" + domainName + "' and ProjectName = '" + projectName + "'";
-        if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-        //execute the update stmt
-        rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-        if(rc!=SQLITE_OK){
-            cerr<<stmt<<endl;
-            fprintf(stderr, "SQL error: %s\n", zErrMsg);
-            sqlite3_free(zErrMsg);
-        }
+    
+    // Count the post-branch call in memory, the counter is written by flushCounters
+    string key;
+    appendKey(key, logName);
+    appendKey(key, logDefFullPath);
+    appendKey(key, domainName);
+    appendKey(key, projectName);
+    unordered_map<string, unsigned>::iterator it = postbranchCounterIndex.find(key);
+    if(it == postbranchCounterIndex.end()){
+        PostbranchCounter counter;
+        counter.logName = logName;
+        counter.logDefLoc = logDefFullPath;
+        counter.domainName = domainName;
+        counter.projectName = projectName;
+        counter.numPostbranchCall = 0;
+        it = postbranchCounterIndex.insert(make_pair(key, postbranchCounters.size())).first;
+        postbranchCounters.push_back(counter);
     }
+    PostbranchCounter& counter = postbranchCounters[it->second];
+    if(counter.prebranchCallSet.insert(callName).second)
+        counter.prebranchCall.push_back(callName);
+    counter.numPostbranchCall++;
+    RunStats::addRow(RunStats::TABLE_POSTBRANCH_CALL);
     return;
 }
 
 // Add an edge of call graph
 void CallData::addCallGraph(string funcName, string funcDefFullPath, string callName, string callDefFullPath, string callLocFullPath, unsigned funcSize){
     
+    // Record the operation when running as a worker
+    if(journal){
+        fputc(JOURNAL_CALL_GRAPH, journal);
+        writeString(journal, funcName);
+        writeString(journal, funcDefFullPath);
+        writeString(journal, callName);
+        writeString(journal, callDefFullPath);
+        writeString(journal, callLocFullPath);
+        fwrite(&funcSize, sizeof(funcSize), 1, journal);
+        return;
+    }
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
     // Get the domain name and project name from given path
     pair<string, string> mDomProName = getDomainProjectName(callLocFullPath);
     string domainName = mDomProName.first;
@@ -451,35 +960,44 @@ void CallData::addCallGraph(string funcName, string funcDefFullPath, string call
         return;
     }
     
-    // Prepare the sql stmt to create the table
-    int rc;
-    char *zErrMsg = 0;
-    string stmt = "create table if not exists call_graph (ID integer primary key autoincrement, FuncName text, FuncDefLoc text, FuncSize integer, DomainName text, ProjectName text, CallName text, CallDefLoc text)";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
-    else
-        rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS func_index ON call_graph(FuncName, FuncDefLoc)", 0, 0, &zErrMsg);
-        
+    // Refer to the files by ID when the path table is enabled
+    funcDefFullPath = encodeLoc(funcDefFullPath);
+    callDefFullPath = encodeLoc(callDefFullPath);
+    
     // Prepare the sql stmt to insert new entry
-    ostringstream oss;
-    oss << funcSize;
-    stmt = "insert into call_graph (FuncName, FuncDefLoc, FuncSize, DomainName, ProjectName, CallName, CallDefLoc) values ('" + funcName + "', '" + funcDefFullPath + "', '" + oss.str() + "', '" + domainName + "', '" + projectName + "', '" + callName + "', '" + callDefFullPath +"')";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
+    sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_CALL_GRAPH, "insert into call_graph (FuncName, FuncDefLoc, FuncSize, DomainName, ProjectName, CallName, CallDefLoc) values (?, ?, ?, ?, ?, ?, ?)");
+    if(!insertStmt)
+        return;
+    bindText(insertStmt, 1, funcName);
+    bindText(insertStmt, 2, funcDefFullPath);
+    sqlite3_bind_int(insertStmt, 3, funcSize);
+    bindText(insertStmt, 4, domainName);
+    bindText(insertStmt, 5, projectName);
+    bindText(insertStmt, 6, callName);
+    bindText(insertStmt, 7, callDefFullPath);
+    
+    beginBatch();
+    if(execStatement(insertStmt))
+        RunStats::addRow(RunStats::TABLE_CALL_GRAPH);
+    commitBatch(false);
     return;
 }
 
 // Add a function call and update call_statistic
 void CallData::addFunctionCall(string callName, string callLocFullPath, string callDefFullPath, string callStr){
     
+    // Record the operation when running as a worker
+    if(journal){
+        fputc(JOURNAL_FUNCTION_CALL, journal);
+        writeString(journal, callName);
+        writeString(journal, callLocFullPath);
+        writeString(journal, callDefFullPath);
+        writeString(journal, callStr);
+        return;
+    }
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
     // Get the domain name and project name from given path
     pair<string, string> mDomProName = getDomainProjectName(callLocFullPath);
     string domainName = mDomProName.first;
@@ -488,121 +1006,514 @@ void CallData::addFunctionCall(string callName, string callLocFullPath, string c
         return;
     }
     
+    // Refer to the files by ID when the path table is enabled
+    callLocFullPath = encodeLoc(callLocFullPath);
+    callDefFullPath = encodeLoc(callDefFullPath);
+    
+    
     
-    // Prepare the sql stmt to create the table
-    int rc;
-    char *zErrMsg = 0;
-    string stmt = "create table if not exists function_call (ID integer primary key autoincrement, CallName text, CallDefLoc text, DomainName text, ProjectName text, CallID text, CallStr text)";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
-    }
-    else
-        rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS call4_index ON function_call(CallName, CallDefLoc)", 0, 0, &zErrMsg);
     
-    callStr = replace_all_distinct(callStr, "'", "''");
+    beginBatch();
+    
     // Prepare the sql stmt to insert new entry
-    stmt = "insert into function_call (CallName, CallDefLoc, DomainName, ProjectName, CallID, CallStr) values ('" + callName + "', '" + callDefFullPath + "', '" + domainName + "', '" + projectName + "', '" + callLocFullPath + "', '" + callStr + "')";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
+    sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_FUNCTION_CALL, "insert into function_call (CallName, CallDefLoc, DomainName, ProjectName, CallID, CallStr) values (?, ?, ?, ?, ?, ?)");
+    if(!insertStmt)
+        return;
+    bindText(insertStmt, 1, callName);
+    bindText(insertStmt, 2, callDefFullPath);
+    bindText(insertStmt, 3, domainName);
+    bindText(insertStmt, 4, projectName);
+    bindText(insertStmt, 5, callLocFullPath);
+    bindText(insertStmt, 6, callStr);
+    if(execStatement(insertStmt))
+        RunStats::addRow(RunStats::TABLE_FUNCTION_CALL);
+    
+    commitBatch(false);
+    
+    // Count the call in memory, the counter is written by flushCounters
+    string key;
+    appendKey(key, callName);
+    appendKey(key, callDefFullPath);
+    appendKey(key, domainName);
+    appendKey(key, projectName);
+    unordered_map<string, unsigned>::iterator it = callCounterIndex.find(key);
+    if(it == callCounterIndex.end()){
+        CallCounter counter;
+        counter.callName = callName;
+        counter.callDefLoc = callDefFullPath;
+        counter.domainName = domainName;
+        counter.projectName = projectName;
+        counter.callNumber = 0;
+        it = callCounterIndex.insert(make_pair(key, callCounters.size())).first;
+        callCounters.push_back(counter);
     }
+    callCounters[it->second].callNumber++;
+    return;
+}
+
+// Get the names of the functions called in at least minProject projects, the same
+// threshold as ehminer.py -m, where a row of call_statistic is a function in a project
+vector<string> CallData::getCommonCalls(unsigned minProject){
     
-    // Prepare the sql stmt to create the table
-    stmt = "create table if not exists call_statistic (ID integer primary key autoincrement, CallName text, CallDefLoc text, DomainName text, ProjectName text, CallNumber integer)";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
+    vector<string> names;
+    sqlite3_stmt* selectStmt;
+    const char* selectSQL = "select distinct CallName from (select CallName from call_statistic group by CallName, CallDefLoc having count(*) >= ?)";
+    if(sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, NULL) != SQLITE_OK){
+        cerr<<selectSQL<<endl;
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        return names;
     }
-    else
-        rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS call3_index ON call_statistic(CallName, CallDefLoc)", 0, 0, &zErrMsg);
-    
-    // Check whether the function is called the first time
-    int ID = 0;
-    vector<string> values;
-    values.clear();
-    // Store ID and values for the certain row
-    pair<int, vector<string>> rowdata = make_pair(ID, values);
-    stmt="select * from call_statistic where CallName = '" + callName + "' and CallDefLoc = '" + callDefFullPath + "' and DomainName = '" + domainName + "' and ProjectName = '" + projectName + "'";
-    if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-    rc = sqlite3_exec(db, stmt.c_str(), cb_get_info, &rowdata, &zErrMsg);
-    if(rc!=SQLITE_OK){
-        cerr<<stmt<<endl;
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
+    sqlite3_bind_int(selectStmt, 1, minProject);
+    while(sqlite3_step(selectStmt) == SQLITE_ROW){
+        const char* name = (const char*) sqlite3_column_text(selectStmt, 0);
+        if(name)
+            names.push_back(name);
     }
+    sqlite3_finalize(selectStmt);
+    return names;
+}
+
+// Replace the path ID of a location written with the path table by the path,
+// a location whose path is not a known ID is kept
+static string decodeLoc(const string& loc, const map<unsigned, string>& paths){
+    size_t digits = 0;
+    while(digits < loc.size() && isdigit((unsigned char) loc[digits]))
+        digits++;
+    if(digits == 0 || (digits < loc.size() && loc[digits] != ':'))
+        return loc;
+    map<unsigned, string>::const_iterator it = paths.find(strtoul(loc.substr(0, digits).c_str(), NULL, 10));
+    return it == paths.end() ? loc : it->second + loc.substr(digits);
+}
+
+// Add the rows of a query to a call graph, a row of four columns is an edge,
+// and a row of two columns is a function. The locations are decoded by paths
+// if it is given, i.e., with the path table.
+static bool readCallGraph(sqlite3* db, const char* selectSQL, CallGraphBuilder& builder, const map<unsigned, string>* paths = NULL){
     
-    // The function is called the first time
-    if(rowdata.first == 0){
-        
-        // Prepare the sql stmt to insert new entry
-        stmt = "insert into call_statistic (CallName, CallDefLoc, DomainName, ProjectName, CallNumber) values ('" + callName + "', '" + callDefFullPath + "', '" + domainName + "', '" + projectName + "' , 1)";
-        if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-        rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-        if(rc!=SQLITE_OK){
-            cerr<<stmt<<endl;
-            fprintf(stderr, "SQL error: %s\n", zErrMsg);
-            sqlite3_free(zErrMsg);
+    sqlite3_stmt* selectStmt;
+    if(sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, NULL) != SQLITE_OK){
+        cerr<<selectSQL<<endl;
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        return false;
+    }
+    int columnNum = sqlite3_column_count(selectStmt);
+    while(sqlite3_step(selectStmt) == SQLITE_ROW){
+        string value[4];
+        for(int i = 0; i < columnNum && i < 4; i++){
+            const char* text = (const char*) sqlite3_column_text(selectStmt, i);
+            value[i] = text ? text : "";
         }
+        if(paths){
+            value[1] = decodeLoc(value[1], *paths);
+            value[3] = decodeLoc(value[3], *paths);
+        }
+        if(columnNum == 4)
+            builder.addEdge(value[0], value[1], value[2], value[3]);
+        else
+            builder.addNode(value[0], value[1]);
     }
-    else{
-        // Prepare the sql stmt to update the entry
-        //get old value
-        int callnumber =  atoi(rowdata.second[5].c_str());
-        //get new value
-        callnumber++;
-        //convert from int to char*
-        char callnumberStr[10];
-        sprintf(callnumberStr, "%d", callnumber);
-        string callnumberString = callnumberStr;
-        stmt = "update call_statistic set CallNumber = " + callnumberString + " where CallName = '" + callName + "' and CallDefLoc = '" + callDefFullPath + "' and DomainName = '" + domainName + "' and ProjectName = '" + projectName + "'";
-        //execute the update stmt
-        if(OUTPUT_SQL_STMT)cerr<<stmt<<endl;
-        rc = sqlite3_exec(db, stmt.c_str(), 0, 0, &zErrMsg);
-        if(rc!=SQLITE_OK){
-            cerr<<stmt<<endl;
-            fprintf(stderr, "SQL error: %s\n", zErrMsg);
-            sqlite3_free(zErrMsg);
+    sqlite3_finalize(selectStmt);
+    return true;
+}
+
+// Write the edges of call_graph to a call graph file, the functions are identified by
+// the names and definition locations, with the paths instead of the IDs of the path table
+bool CallData::writeCallGraphIndex(string file){
+    
+    map<unsigned, string> paths;
+    if(pathTable){
+        sqlite3_stmt* selectStmt;
+        if(sqlite3_prepare_v2(db, "select ID, Path from file_path", -1, &selectStmt, NULL) != SQLITE_OK){
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+            return false;
+        }
+        while(sqlite3_step(selectStmt) == SQLITE_ROW){
+            const char* path = (const char*) sqlite3_column_text(selectStmt, 1);
+            paths[sqlite3_column_int(selectStmt, 0)] = path ? path : "";
         }
+        sqlite3_finalize(selectStmt);
     }
-    return;
+    
+    CallGraphBuilder builder;
+    if(!readCallGraph(db, "select distinct FuncName, FuncDefLoc, CallName, CallDefLoc from call_graph", builder, pathTable ? &paths : NULL))
+        return false;
+    return builder.write(file);
 }
 
-// Get the domain and project name from the full path of the file
-pair<string, string> CallData::getDomainProjectName(string callLocation){
+// Summarize the actions of the functions in call_graph and the post-branch functions
+// in branch_call, and replace the rows of function_summary
+bool CallData::writeActionSummary(){
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
+    // The post-branch functions, e.g., 'return', may be out of the call graph
+    CallGraphBuilder builder;
+    vector<char> image;
+    CallGraphIndex graph;
+    if(!readCallGraph(db, "select distinct FuncName, FuncDefLoc, CallName, CallDefLoc from call_graph", builder) ||
+       !readCallGraph(db, "select distinct LogName, LogDefLoc from branch_call", builder) ||
+       !builder.build(image) || !graph.assign(image))
+        return false;
     
-    // Get the domain and project name
-    vector<string> mDomainName = configData.getDomainName();
-    vector<vector<string>> mProjectName = configData.getProjectName();
+    ActionSummary summary;
+    summary.compute(graph);
     
-    // For each domain
-    for(unsigned i = 0; i < mDomainName.size(); i++){
+    // Only the functions taking any action are stored
+    commitBatch(true);
+    beginBatch();
+    execSQL("delete from function_summary");
+    for(unsigned node = 0; node < graph.getNodeNum(); node++){
+        unsigned mask = summary.getMask(node);
+        if(mask == 0)
+            continue;
+        sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_FUNCTION_SUMMARY, "insert into function_summary (FuncName, FuncDefLoc, ActionMask, ExitLevel, OutputLevel, FreeLevel, DeleteLevel, CloseLevel, ReturnLevel, GotoLevel, BreakLevel, ContinueLevel) values (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        if(!insertStmt)
+            return false;
+        sqlite3_bind_text(insertStmt, 1, graph.getName(node), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 2, graph.getDefLoc(node), -1, SQLITE_STATIC);
+        sqlite3_bind_int(insertStmt, 3, mask);
+        for(unsigned action = 0; action < ActionSummary::ACTION_NUM; action++)
+            sqlite3_bind_int(insertStmt, action + 4, summary.getLevel(node, action));
         
-        // The full path contains the domain name
-        if(callLocation.find("/"+mDomainName[i]+"/") != string::npos){
-            
-            // For each project
-            for(unsigned j = 0; j < mProjectName[i].size(); j++){
-                
-                // The full path contains the project name
-                if(callLocation.find("/"+mProjectName[i][j]+"/") != string::npos){
-                    
-                    // Make the pair of doamin name and project name, and return
-                    return make_pair(mDomainName[i], mProjectName[i][j]);
+        beginBatch();
+        execStatement(insertStmt);
+        commitBatch(false);
+    }
+    commitBatch(true);
+    return true;
+}
+
+// Re-analyze only the changed translation units, this should be set before opening the database
+void CallData::setIncremental(bool enable){
+    incremental = enable;
+}
+
+// The tables whose rows are replaced when a translation unit is re-analyzed,
+// the rows of a translation unit are a range of IDs in each table
+static const char* rowTables[3] = {"branch_call", "function_call", "call_graph"};
+
+// Get the largest ID in a table, 0 for an empty table
+static long long getMaxRowID(sqlite3* db, const char* table){
+    long long ID = 0;
+    sqlite3_stmt* stmt;
+    string sql = string("select ifnull(max(ID), 0) from ") + table;
+    if(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK){
+        cerr<<sql<<endl;
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+        ID = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    return ID;
+}
+
+// Get the hash and dependencies recorded for a translation unit, return false if it is not analyzed
+bool CallData::getTranslationUnit(string sourceFile, string& hash, vector<string>& deps){
+    
+    hash.clear();
+    deps.clear();
+    
+    sqlite3_stmt* selectStmt = getStatement(STMT_SELECT_TU_CACHE, "select ID, Hash, Dependencies from tu_cache where SourceFile = ?");
+    if(!selectStmt)
+        return false;
+    bindText(selectStmt, 1, sourceFile);
+    pair<int, vector<string>> rowdata = selectStatement(selectStmt);
+    if(rowdata.first == 0)
+        return false;
+    
+    hash = rowdata.second[1];
+    
+    // The dependencies are joined by '\n'
+    const string& depStr = rowdata.second[2];
+    size_t begin = 0;
+    while(begin < depStr.size()){
+        size_t end = depStr.find('\n', begin);
+        if(end == string::npos)
+            end = depStr.size();
+        deps.push_back(depStr.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return true;
+}
+
+// Begin re-analyzing a translation unit. The rows of its last analysis are removed,
+// and the following rows are written in one transaction until endTranslationUnit.
+void CallData::beginTranslationUnit(string sourceFile){
+    
+    if(!incremental || journal)
+        return;
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
+    dependencies.clear();
+    
+    // Commit the rows of previous translation units, and start a transaction for this one
+    flushCounters(true);
+    commitBatch(true);
+    if(!execSQL("BEGIN TRANSACTION"))
+        return;
+    inTransaction = true;
+    inTranslationUnit = true;
+    pendingRows = 0;
+    
+    // Find the rows of the last analysis, if any
+    sqlite3_stmt* selectStmt;
+    const char* selectSQL = "select BranchCallFirst, BranchCallLast, FunctionCallFirst, FunctionCallLast, CallGraphFirst, CallGraphLast from tu_cache where SourceFile = ?";
+    if(sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, NULL) != SQLITE_OK){
+        cerr<<selectSQL<<endl;
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        return;
+    }
+    bindText(selectStmt, 1, sourceFile);
+    long long range[6];
+    bool found = sqlite3_step(selectStmt) == SQLITE_ROW;
+    for(int i = 0; found && i < 6; i++)
+        range[i] = sqlite3_column_int64(selectStmt, i);
+    sqlite3_finalize(selectStmt);
+    
+    if(found){
+        // Decrease call_statistic by the function calls of the last analysis
+        sqlite3_stmt* countStmt;
+        const char* countSQL = "select CallName, CallDefLoc, DomainName, ProjectName, count(*) from function_call where ID between ? and ? group by CallName, CallDefLoc, DomainName, ProjectName";
+        if(sqlite3_prepare_v2(db, countSQL, -1, &countStmt, NULL) == SQLITE_OK){
+            sqlite3_bind_int64(countStmt, 1, range[2]);
+            sqlite3_bind_int64(countStmt, 2, range[3]);
+            while(sqlite3_step(countStmt) == SQLITE_ROW){
+                sqlite3_stmt* updateStmt = getStatement(STMT_DECREASE_CALL_STATISTIC, "update call_statistic set CallNumber = CallNumber - ? where CallName = ? and CallDefLoc = ? and DomainName = ? and ProjectName = ?");
+                if(!updateStmt)
+                    break;
+                sqlite3_bind_int(updateStmt, 1, sqlite3_column_int(countStmt, 4));
+                for(int i = 0; i < 4; i++){
+                    const char* value = (const char*) sqlite3_column_text(countStmt, i);
+                    sqlite3_bind_text(updateStmt, i + 2, value ? value : "", -1, SQLITE_TRANSIENT);
                 }
+                execStatement(updateStmt);
             }
+            sqlite3_finalize(countStmt);
+        }
+        else{
+            cerr<<countSQL<<endl;
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        }
+        execSQL("delete from call_statistic where CallNumber <= 0");
+        
+        // Remove the rows of the last analysis
+        for(int i = 0; i < 3; i++){
+            char deleteSQL[200];
+            sprintf(deleteSQL, "delete from %s where ID between %lld and %lld", rowTables[i], range[i * 2], range[i * 2 + 1]);
+            execSQL(deleteSQL);
         }
     }
     
-    // Return an empty pair
-    return make_pair("", "");
+    // The new rows start after the current largest IDs
+    for(int i = 0; i < 3; i++)
+        firstRowID[i] = getMaxRowID(db, rowTables[i]) + 1;
+}
+
+// Add a file the translation unit depends on, including the main file
+void CallData::addDependency(string fileFullPath){
+    
+    if(!incremental)
+        return;
+    
+    // Record the operation when running as a worker
+    if(journal){
+        fputc(JOURNAL_DEPENDENCY, journal);
+        writeString(journal, fileFullPath);
+        return;
+    }
+    
+    dependencies.push_back(fileFullPath);
+}
+
+// Get the files the current translation unit depends on, sorted and unique
+const vector<string>& CallData::getDependencies(){
+    sort(dependencies.begin(), dependencies.end());
+    dependencies.erase(unique(dependencies.begin(), dependencies.end()), dependencies.end());
+    return dependencies;
+}
+
+// Finish re-analyzing a translation unit, record its hash and rows, and commit
+void CallData::endTranslationUnit(string sourceFile, string hash){
+    
+    if(!inTranslationUnit)
+        return;
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
+    flushCounters(true);
+    
+    string depStr;
+    const vector<string>& deps = getDependencies();
+    for(unsigned i = 0; i < deps.size(); i++){
+        depStr += deps[i];
+        if(i != deps.size() - 1)
+            depStr += '\n';
+    }
+    
+    sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_TU_CACHE, "insert or replace into tu_cache (SourceFile, Hash, Dependencies, BranchCallFirst, BranchCallLast, FunctionCallFirst, FunctionCallLast, CallGraphFirst, CallGraphLast) values (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    if(insertStmt){
+        bindText(insertStmt, 1, sourceFile);
+        bindText(insertStmt, 2, hash);
+        bindText(insertStmt, 3, depStr);
+        for(int i = 0; i < 3; i++){
+            sqlite3_bind_int64(insertStmt, i * 2 + 4, firstRowID[i]);
+            sqlite3_bind_int64(insertStmt, i * 2 + 5, getMaxRowID(db, rowTables[i]));
+        }
+        execStatement(insertStmt);
+    }
+    
+    inTranslationUnit = false;
+    commitBatch(true);
+    dependencies.clear();
+}
+
+// Write the counters aggregated in memory to call_statistic, prebranch_call and postbranch_call.
+// The counters are written in the order they first appear, so the tables are the same as
+// updating the counters call by call.
+void CallData::flushCounters(bool force){
+    
+    // In bulk-load mode, the counters are written once after the indexes are built
+    if(journal || (bulkLoad && !force))
+        return;
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_SQLITE);
+    
+    beginBatch();
+    
+    // Add the call numbers to call_statistic
+    for(unsigned i = 0; i < callCounters.size(); i++){
+        CallCounter& counter = callCounters[i];
+        sqlite3_stmt* updateStmt = getStatement(STMT_UPDATE_CALL_STATISTIC, "update call_statistic set CallNumber = CallNumber + ? where CallName = ? and CallDefLoc = ? and DomainName = ? and ProjectName = ?");
+        if(!updateStmt)
+            break;
+        sqlite3_bind_int(updateStmt, 1, counter.callNumber);
+        bindText(updateStmt, 2, counter.callName);
+        bindText(updateStmt, 3, counter.callDefLoc);
+        bindText(updateStmt, 4, counter.domainName);
+        bindText(updateStmt, 5, counter.projectName);
+        execStatement(updateStmt);
+        
+        // The function is called the first time
+        if(sqlite3_changes(db) == 0){
+            sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_CALL_STATISTIC, "insert into call_statistic (CallName, CallDefLoc, DomainName, ProjectName, CallNumber) values (?, ?, ?, ?, ?)");
+            if(!insertStmt)
+                break;
+            bindText(insertStmt, 1, counter.callName);
+            bindText(insertStmt, 2, counter.callDefLoc);
+            bindText(insertStmt, 3, counter.domainName);
+            bindText(insertStmt, 4, counter.projectName);
+            sqlite3_bind_int(insertStmt, 5, counter.callNumber);
+            execStatement(insertStmt);
+        }
+        commitBatch(false);
+    }
+    callCounters.clear();
+    callCounterIndex.clear();
+    
+    // Add the log times to prebranch_call
+    for(unsigned i = 0; i < prebranchCounters.size(); i++){
+        PrebranchCounter& counter = prebranchCounters[i];
+        sqlite3_stmt* updateStmt = getStatement(STMT_UPDATE_PREBRANCH_CALL, "update prebranch_call set NumLogTime = NumLogTime + ? where LogName = ? and LogDefLoc = ? and CallName = ? and CallDefLoc = ? and DomainName = ? and ProjectName = ?");
+        if(!updateStmt)
+            break;
+        sqlite3_bind_int(updateStmt, 1, counter.numLogTime);
+        bindText(updateStmt, 2, counter.logName);
+        bindText(updateStmt, 3, counter.logDefLoc);
+        bindText(updateStmt, 4, counter.callName);
+        bindText(updateStmt, 5, counter.callDefLoc);
+        bindText(updateStmt, 6, counter.domainName);
+        bindText(updateStmt, 7, counter.projectName);
+        execStatement(updateStmt);
+        
+        // The function is called the first time
+        if(sqlite3_changes(db) == 0){
+            sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_PREBRANCH_CALL, "insert into prebranch_call (CallName, CallDefLoc, DomainName, ProjectName, LogName, LogDefLoc, NumLogTime) values (?, ?, ?, ?, ?, ?, ?)");
+            if(!insertStmt)
+                break;
+            bindText(insertStmt, 1, counter.callName);
+            bindText(insertStmt, 2, counter.callDefLoc);
+            bindText(insertStmt, 3, counter.domainName);
+            bindText(insertStmt, 4, counter.projectName);
+            bindText(insertStmt, 5, counter.logName);
+            bindText(insertStmt, 6, counter.logDefLoc);
+            sqlite3_bind_int(insertStmt, 7, counter.numLogTime);
+            execStatement(insertStmt);
+        }
+        commitBatch(false);
+    }
+    prebranchCounters.clear();
+    prebranchCounterIndex.clear();
+    
+    // Merge the pre-branch calls and add the numbers to postbranch_call
+    for(unsigned i = 0; i < postbranchCounters.size(); i++){
+        PostbranchCounter& counter = postbranchCounters[i];
+        sqlite3_stmt* selectStmt = getStatement(STMT_SELECT_POSTBRANCH_CALL, "select * from postbranch_call where LogName = ? and LogDefLoc = ? and DomainName = ? and ProjectName = ?");
+        if(!selectStmt)
+            break;
+        bindText(selectStmt, 1, counter.logName);
+        bindText(selectStmt, 2, counter.logDefLoc);
+        bindText(selectStmt, 3, counter.domainName);
+        bindText(selectStmt, 4, counter.projectName);
+        // Store ID and values for the certain row
+        pair<int, vector<string>> rowdata = selectStatement(selectStmt);
+        
+        string prebranchCall = "#";
+        int numPrebranchCall = 0;
+        int numPostbranchCall = 0;
+        if(rowdata.first != 0){
+            prebranchCall = rowdata.second[5];
+            numPrebranchCall = atoi(rowdata.second[6].c_str());
+            numPostbranchCall = atoi(rowdata.second[7].c_str());
+        }
+        for(unsigned j = 0; j < counter.prebranchCall.size(); j++){
+            if(prebranchCall.find("#" + counter.prebranchCall[j] + "#") == string::npos){
+                prebranchCall += counter.prebranchCall[j] + "#";
+                numPrebranchCall++;
+            }
+        }
+        numPostbranchCall += counter.numPostbranchCall;
+        
+        // The function is called the first time
+        if(rowdata.first == 0){
+            sqlite3_stmt* insertStmt = getStatement(STMT_INSERT_POSTBRANCH_CALL, "insert into postbranch_call (LogName, LogDefLoc, DomainName, ProjectName, PrebranchCall, NumPrebranchCall, NumPostbranchCall) values (?, ?, ?, ?, ?, ?, ?)");
+            if(!insertStmt)
+                break;
+            bindText(insertStmt, 1, counter.logName);
+            bindText(insertStmt, 2, counter.logDefLoc);
+            bindText(insertStmt, 3, counter.domainName);
+            bindText(insertStmt, 4, counter.projectName);
+            bindText(insertStmt, 5, prebranchCall);
+            sqlite3_bind_int(insertStmt, 6, numPrebranchCall);
+            sqlite3_bind_int(insertStmt, 7, numPostbranchCall);
+            execStatement(insertStmt);
+        }
+        else{
+            sqlite3_stmt* updateStmt = getStatement(STMT_UPDATE_POSTBRANCH_CALL, "update postbranch_call set PrebranchCall = ?, NumPrebranchCall = ?, NumPostbranchCall = ? where ID = ?");
+            if(!updateStmt)
+                break;
+            bindText(updateStmt, 1, prebranchCall);
+            sqlite3_bind_int(updateStmt, 2, numPrebranchCall);
+            sqlite3_bind_int(updateStmt, 3, numPostbranchCall);
+            sqlite3_bind_int(updateStmt, 4, rowdata.first);
+            execStatement(updateStmt);
+        }
+        commitBatch(false);
+    }
+    postbranchCounters.clear();
+    postbranchCounterIndex.clear();
+}
+
+// Get the domain and project name from the full path of the file
+pair<string, string> CallData::getDomainProjectName(string callLocation){
+    
+    // The ":line:column" suffix has no '/', so match the file path only,
+    // then all the locations in a file share one cached result
+    pair<int, int> index = configData.matchDomainProject(callLocation.substr(0, getPathLength(callLocation)));
+    if(index.first < 0)
+        return make_pair("", "");
+    
+    // Make the pair of doamin name and project name, and return
+    return make_pair(configData.getDomainName()[index.first], configData.getProjectName()[index.first][index.second]);
 }
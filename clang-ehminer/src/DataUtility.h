@@ -17,13 +17,18 @@
 
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
 
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include <cstdio>
 #include <sqlite3.h>
 
+#include "RunStats.h"
+
 #define MAX_PROJECT 100
 
 #define OUTPUT_SQL_STMT 0
@@ -48,10 +53,13 @@ public:
     void addProjectName(unsigned domainIndex, string name);
     
     // Get the 1-dim domain name
-    vector<string> getDomainName();
+    const vector<string>& getDomainName();
     
     // Get the 2-dim project name
-    vector<vector<string>> getProjectName();
+    const vector<vector<string>>& getProjectName();
+    
+    // Find the indexes of the domain and project of a file path, (-1, -1) if not found
+    pair<int, int> matchDomainProject(const string& filePath);
     
     // Print the static members
     void printName();
@@ -62,6 +70,17 @@ private:
     
     // Store the project information by a two-dimention vector
     static vector<vector<string>> projectName;
+    
+    // The indexes of the domains by name, and the indexes of the projects by
+    // name in each domain, used to match the components of a path
+    static unordered_map<string, vector<unsigned>> domainIndex;
+    static vector<unordered_map<string, unsigned>> projectIndex;
+    
+    // Whether all the names are plain path components, i.e., non-empty and without '/'
+    static bool hasPlainNames;
+    
+    // The matched domain and project of each file path
+    static unordered_map<string, pair<int, int>> matchCache;
 };
 
 //===----------------------------------------------------------------------===//
@@ -133,8 +152,143 @@ public:
     
     // Get the SQLite database
     sqlite3* getDatabase();
+    
+    // Get the names of the functions called in at least minProject projects,
+    // as counted in call_statistic by a census pass
+    vector<string> getCommonCalls(unsigned minProject);
+    
+    // Write the edges of call_graph to a call graph file in compressed sparse
+    // row form, which is queried by CallGraphIndex, return false on failure
+    bool writeCallGraphIndex(string file);
+    
+    // Summarize the actions of the functions bottom-up over call_graph, and
+    // replace the rows of function_summary, return false on failure
+    bool writeActionSummary();
+    
+    // Journal the following add* operations to a file instead of the database.
+    // A worker process analyzing one source file uses this, and the parent
+    // process replays the journal, so only the parent writes the database.
+    bool startJournal(string journalFile);
+    
+    // Stop journaling and flush the journal file
+    void stopJournal();
+    
+    // Replay the add* operations recorded in a journal file
+    bool replayJournal(string journalFile);
+    
+    // Add the profile of a source file, a worker journals it for the parent
+    void addFileStats(const RunStats::FileStats& fileStats);
+    
+    // Set the number of rows written in one transaction, 0 means autocommit
+    void setTransactionSize(unsigned size);
+    
+    // Write the counters aggregated in memory to the database, this is done
+    // at the end of each translation unit and when closing the database.
+    // In bulk-load mode, the counters are written only when force is set.
+    void flushCounters(bool force = false);
+    
+    // Store the file paths in table file_path, and refer to them by ID in the
+    // location columns, this should be set before opening the database
+    void setPathTable(bool enable);
+    
+    // Re-analyze only the changed translation units, and replace their rows,
+    // this should be set before opening the database
+    void setIncremental(bool enable);
+    
+    // Get the hash and dependencies recorded for a translation unit, return
+    // false if it has not been analyzed
+    bool getTranslationUnit(string sourceFile, string& hash, vector<string>& deps);
+    
+    // Begin re-analyzing a translation unit, the rows of its last analysis are removed
+    void beginTranslationUnit(string sourceFile);
+    
+    // Add a file the current translation unit depends on
+    void addDependency(string fileFullPath);
+    
+    // Get the files the current translation unit depends on, sorted and unique
+    const vector<string>& getDependencies();
+    
+    // Finish re-analyzing a translation unit, and commit its rows with its hash
+    void endTranslationUnit(string sourceFile, string hash);
+    
+    // Load the rows in bulk, the indexes are built and the counters are
+    // written after ingestion, this should be set before opening the database
+    void setBulkLoad(bool enable);
 
 private:
+#ifdef EHMINER_BENCH
+    // The micro-benchmarks call the private hot paths directly, only in ehminer-bench
+    friend class EhminerBench;
+#endif
+    
+    // Execute a sql stmt which returns no row
+    bool execSQL(string stmt);
+    
+    // Create the tables if not exist
+    void createTables();
+    
+    // Create the indexes if not exist
+    void createIndexes();
+    
+    // Drop the indexes, used by bulk-load mode
+    void dropIndexes();
+    
+    // Get the ID of a file path in table file_path
+    unsigned getPathID(const string& path);
+    
+    // Get the ID of an operand of branch conditions in table expr_operand
+    unsigned getOperandID(const string& operand);
+    
+    // Get the actions a post-branch function stands for, as a bitmask of ActionSummary::Action
+    unsigned getLogActionMask(const string& logName);
+    
+    // Replace the path of a location by its ID when the path table is enabled
+    string encodeLoc(const string& loc);
+    
+    // The cached prepared statements
+    enum StmtID{
+        STMT_INSERT_BRANCH_CALL,
+        STMT_INSERT_PREBRANCH_CALL,
+        STMT_UPDATE_PREBRANCH_CALL,
+        STMT_SELECT_POSTBRANCH_CALL,
+        STMT_INSERT_POSTBRANCH_CALL,
+        STMT_UPDATE_POSTBRANCH_CALL,
+        STMT_INSERT_CALL_GRAPH,
+        STMT_INSERT_FUNCTION_CALL,
+        STMT_INSERT_CALL_STATISTIC,
+        STMT_UPDATE_CALL_STATISTIC,
+        STMT_INSERT_FILE_PATH,
+        STMT_SELECT_FILE_PATH,
+        STMT_INSERT_EXPR_OPERAND,
+        STMT_SELECT_EXPR_OPERAND,
+        STMT_SELECT_TU_CACHE,
+        STMT_INSERT_TU_CACHE,
+        STMT_DECREASE_CALL_STATISTIC,
+        STMT_INSERT_FUNCTION_SUMMARY,
+        STMT_NUM
+    };
+    
+    // Get the cached prepared statement, prepare it at the first time
+    sqlite3_stmt* getStatement(StmtID id, const char* sql);
+    
+    // Get the ID of a string in a table of unique strings, e.g., file_path
+    unsigned getStringID(const string& str, unordered_map<string, unsigned>& IDs, StmtID insertID, const char* insertSQL, StmtID selectID, const char* selectSQL);
+    
+    // Finalize all the cached prepared statements
+    void finalizeStatements();
+    
+    // Step a prepared statement which returns no row
+    bool execStatement(sqlite3_stmt* stmt);
+    
+    // Step a prepared statement which selects at most one row
+    pair<int, vector<string>> selectStatement(sqlite3_stmt* stmt);
+    
+    // Begin a transaction if rows are committed in batch
+    void beginBatch();
+    
+    // Count a written row, and commit the transaction when the batch is full or force is set
+    void commitBatch(bool force);
+    
     // Get the domain and project name from the full path of the file
     pair<string, string> getDomainProjectName(string callLocation);
     
@@ -143,6 +297,73 @@ private:
     
     // The SQLite database
     static sqlite3 *db;
+    
+    // The journal file, add* operations are written here when it is not null
+    static FILE *journal;
+    
+    // The prepared statements, indexed by StmtID
+    static sqlite3_stmt *preparedStmt[STMT_NUM];
+    
+    // The number of rows per transaction, and the rows written in current transaction
+    static unsigned transactionSize;
+    static unsigned pendingRows;
+    static bool inTransaction;
+    
+    // Whether to build the indexes after ingestion
+    static bool bulkLoad;
+    
+    // Whether to refer to the files by ID, and the IDs of the file paths
+    static bool pathTable;
+    static unordered_map<string, unsigned> pathIDs;
+    
+    // The IDs of the operands of branch conditions, used by ExprNodeCode of branch_call
+    static unordered_map<string, unsigned> operandIDs;
+    
+    // The action bitmasks of the post-branch functions, used by LogActionMask of branch_call
+    static unordered_map<string, unsigned> logActionMasks;
+    
+    // Whether to re-analyze only the changed translation units, whether a translation
+    // unit is being re-analyzed, its dependencies, and the first IDs of its rows in
+    // branch_call, function_call and call_graph
+    static bool incremental;
+    static bool inTranslationUnit;
+    static vector<string> dependencies;
+    static long long firstRowID[3];
+    
+    // The counters of call_statistic, prebranch_call and postbranch_call, which are
+    // aggregated in memory and indexed by the key columns joined by '\0'. The vectors
+    // keep the order in which the counters first appear.
+    struct CallCounter{
+        string callName;
+        string callDefLoc;
+        string domainName;
+        string projectName;
+        unsigned callNumber;
+    };
+    struct PrebranchCounter{
+        string callName;
+        string callDefLoc;
+        string domainName;
+        string projectName;
+        string logName;
+        string logDefLoc;
+        unsigned numLogTime;
+    };
+    struct PostbranchCounter{
+        string logName;
+        string logDefLoc;
+        string domainName;
+        string projectName;
+        vector<string> prebranchCall;
+        set<string> prebranchCallSet;
+        unsigned numPostbranchCall;
+    };
+    static vector<CallCounter> callCounters;
+    static unordered_map<string, unsigned> callCounterIndex;
+    static vector<PrebranchCounter> prebranchCounters;
+    static unordered_map<string, unsigned> prebranchCounterIndex;
+    static vector<PostbranchCounter> postbranchCounters;
+    static unordered_map<string, unsigned> postbranchCounterIndex;
 };
 
 #endif /* DataUtility_h */
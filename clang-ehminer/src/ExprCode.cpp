@@ -0,0 +1,202 @@
+//===------ ExprCode.cpp - A compact binary encoding of branch conditions ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a compact binary encoding of the expr node vector.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ExprCode.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+// The spellings of the clang UnaryOperatorKind and BinaryOperatorKind, in the
+// order of clang/AST/OperationKinds.def
+static const char* unaryOpcodeStr[] = {
+    "++", "--", "++", "--", "&", "*", "+", "-", "~", "!",
+    "__real", "__imag", "__extension__", "co_await"
+};
+static const char* binaryOpcodeStr[] = {
+    ".*", "->*", "*", "/", "%", "+", "-", "<<", ">>",
+    "<", ">", "<=", ">=", "==", "!=", "&", "^", "|", "&&", "||",
+    "=", "*=", "/=", "%=", "+=", "-=", "<<=", ">>=", "&=", "^=", "|=", ","
+};
+
+// The names of ExprType in the expr node vector, e.g., "UO_VARIABLE_INT"
+static const char* typeStr[ExprCode::TYPE_NUM] = {
+    "INT", "FLOAT", "BOOL", "POINTER", "NONE", "NULL", "STRING"
+};
+
+// Append an unsigned varint, 7 bits per byte and the high bit means more bytes
+static void appendVarint(string& code, unsigned long long value){
+    while(value >= 0x80){
+        code += (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    code += (char)value;
+}
+
+// Read an unsigned varint, return false if the code ends
+static bool readVarint(const string& code, size_t& pos, unsigned long long& value){
+    value = 0;
+    for(int shift = 0; pos < code.size() && shift < 64; shift += 7){
+        unsigned char byte = code[pos++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Get the opcode of "UO_<code>_<spelling>" or "BO_<code>_<spelling>", -1 if not matched
+static int getOperatorCode(const string& node, const char* prefix, const char** spelling, int num){
+    if(node.compare(0, 3, prefix) != 0)
+        return -1;
+    size_t end = node.find('_', 3);
+    // The code has one or two digits, printed without leading zeros
+    if(end == string::npos || end == 3 || end > 5 || (node[3] == '0' && end > 4))
+        return -1;
+    int opcode = 0;
+    for(size_t i = 3; i < end; i++){
+        if(node[i] < '0' || node[i] > '9')
+            return -1;
+        opcode = opcode * 10 + node[i] - '0';
+    }
+    if(opcode >= num || node.compare(end + 1, string::npos, spelling[opcode]) != 0)
+        return -1;
+    return opcode;
+}
+
+// Get the ExprType of "UO_VARIABLE_<type>" or "UO_CONSTANT_<type>", -1 if not matched
+static int getType(const string& node, const string& prefix){
+    if(node.compare(0, prefix.size(), prefix) != 0)
+        return -1;
+    for(int type = 0; type < ExprCode::TYPE_NUM; type++)
+        if(node.compare(prefix.size(), string::npos, typeStr[type]) == 0)
+            return type;
+    return -1;
+}
+
+// Parse an integer printed in decimal without leading zeros, return false if not matched
+static bool getInteger(const string& node, long long& value){
+    if(node.empty() || node.size() > 20 || node == "-0")
+        return false;
+    size_t begin = node[0] == '-' ? 1 : 0;
+    if(begin == node.size() || (node[begin] == '0' && node.size() > begin + 1))
+        return false;
+    for(size_t i = begin; i < node.size(); i++)
+        if(node[i] < '0' || node[i] > '9')
+            return false;
+    
+    errno = 0;
+    value = strtoll(node.c_str(), NULL, 10);
+    return errno == 0;
+}
+
+// Encode the expr node vector, getOperandID gives the ID of an operand text
+string ExprCode::encode(const vector<string>& exprNodeVec, function<unsigned(const string&)> getOperandID){
+    string code;
+    for(unsigned i = 0; i < exprNodeVec.size(); i++){
+        const string& node = exprNodeVec[i];
+        long long value;
+        int opcode;
+        
+        if(node == ":?")
+            code += (char)EXPR_CONDITIONAL;
+        else if(node == "BO_ARRAY")
+            code += (char)EXPR_ARRAY;
+        else if(node == "BO_MEMBER")
+            code += (char)EXPR_MEMBER;
+        else if((opcode = getType(node, "UO_VARIABLE_")) >= 0){
+            code += (char)EXPR_VARIABLE;
+            code += (char)opcode;
+        }
+        else if((opcode = getType(node, "UO_CONSTANT_")) >= 0){
+            code += (char)EXPR_CONSTANT;
+            code += (char)opcode;
+        }
+        else if((opcode = getOperatorCode(node, "UO_", unaryOpcodeStr, sizeof(unaryOpcodeStr) / sizeof(char*))) >= 0){
+            code += (char)EXPR_UNARY;
+            code += (char)opcode;
+        }
+        else if((opcode = getOperatorCode(node, "BO_", binaryOpcodeStr, sizeof(binaryOpcodeStr) / sizeof(char*))) >= 0){
+            code += (char)EXPR_BINARY;
+            code += (char)opcode;
+        }
+        // An integer literal is followed by its type, e.g., "UO_CONSTANT_INT"
+        else if(i + 1 < exprNodeVec.size() && getType(exprNodeVec[i + 1], "UO_CONSTANT_") >= 0 && getInteger(node, value)){
+            code += (char)EXPR_INTEGER;
+            appendVarint(code, ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+        }
+        else{
+            code += (char)EXPR_OPERAND;
+            appendVarint(code, getOperandID(node));
+        }
+    }
+    return code;
+}
+
+// Decode the expr node vector, getOperand gives the text of an operand ID
+bool ExprCode::decode(const string& code, function<string(unsigned)> getOperand, vector<string>& exprNodeVec){
+    exprNodeVec.clear();
+    size_t pos = 0;
+    while(pos < code.size()){
+        unsigned char opcode = code[pos++];
+        unsigned long long value;
+        char number[30];
+        
+        switch(opcode){
+            case EXPR_OPERAND:
+                if(!readVarint(code, pos, value))
+                    return false;
+                exprNodeVec.push_back(getOperand(value));
+                break;
+            case EXPR_INTEGER:
+                if(!readVarint(code, pos, value))
+                    return false;
+                sprintf(number, "%lld", (long long)(value >> 1) ^ -(long long)(value & 1));
+                exprNodeVec.push_back(number);
+                break;
+            case EXPR_UNARY:
+            case EXPR_BINARY:{
+                if(pos >= code.size())
+                    return false;
+                unsigned char op = code[pos++];
+                bool unary = opcode == EXPR_UNARY;
+                if(op >= (unary ? sizeof(unaryOpcodeStr) : sizeof(binaryOpcodeStr)) / sizeof(char*))
+                    return false;
+                sprintf(number, "%d", op);
+                exprNodeVec.push_back(string(unary ? "UO_" : "BO_") + number + "_" + (unary ? unaryOpcodeStr[op] : binaryOpcodeStr[op]));
+                break;
+            }
+            case EXPR_VARIABLE:
+            case EXPR_CONSTANT:{
+                if(pos >= code.size() || (unsigned char)code[pos] >= TYPE_NUM)
+                    return false;
+                unsigned char type = code[pos++];
+                exprNodeVec.push_back(string(opcode == EXPR_VARIABLE ? "UO_VARIABLE_" : "UO_CONSTANT_") + typeStr[type]);
+                break;
+            }
+            case EXPR_CONDITIONAL:
+                exprNodeVec.push_back(":?");
+                break;
+            case EXPR_ARRAY:
+                exprNodeVec.push_back("BO_ARRAY");
+                break;
+            case EXPR_MEMBER:
+                exprNodeVec.push_back("BO_MEMBER");
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
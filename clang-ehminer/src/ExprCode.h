@@ -0,0 +1,77 @@
+//===- ExprCode.h - A compact binary encoding of branch conditions -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a compact binary encoding of the expr node vector.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ExprCode_h
+#define ExprCode_h
+
+#include <vector>
+#include <string>
+#include <functional>
+
+using namespace std;
+
+//===----------------------------------------------------------------------===//
+//
+//                     ExprCode Class
+//
+//===----------------------------------------------------------------------===//
+// The expr node vector of a branch condition is in reverse Polish notation, e.g.,
+// {"ret", "UO_VARIABLE_INT", "0", "UO_CONSTANT_INT", "BO_13_=="} for ret == 0.
+// We encode it as a byte string, each node is an opcode byte followed by its
+// slot:
+//      EXPR_OPERAND     varint, ID of the operand text, e.g., a variable name
+//      EXPR_INTEGER     zigzag varint, an integer literal
+//      EXPR_UNARY       byte, the clang UnaryOperatorKind
+//      EXPR_BINARY      byte, the clang BinaryOperatorKind
+//      EXPR_VARIABLE    byte, the ExprType of the variable on the stack top
+//      EXPR_CONSTANT    byte, the ExprType of the constant on the stack top
+//      EXPR_CONDITIONAL, EXPR_ARRAY, EXPR_MEMBER  no slot
+// The operand IDs are given by the caller, so that the texts are stored once.
+// A node which doesn't match any opcode is kept as an operand, so decoding
+// always gives back the same expr node vector.
+//===----------------------------------------------------------------------===//
+class ExprCode{
+public:
+    enum ExprOpcode{
+        EXPR_OPERAND = 1,
+        EXPR_INTEGER,
+        EXPR_UNARY,
+        EXPR_BINARY,
+        EXPR_VARIABLE,
+        EXPR_CONSTANT,
+        EXPR_CONDITIONAL,
+        EXPR_ARRAY,
+        EXPR_MEMBER
+    };
+    
+    enum ExprType{
+        TYPE_INT,
+        TYPE_FLOAT,
+        TYPE_BOOL,
+        TYPE_POINTER,
+        TYPE_NONE,
+        TYPE_NULL,
+        TYPE_STRING,
+        TYPE_NUM
+    };
+    
+    // Encode the expr node vector, getOperandID gives the ID of an operand text
+    static string encode(const vector<string>& exprNodeVec, function<unsigned(const string&)> getOperandID);
+    
+    // Decode the expr node vector, getOperand gives the text of an operand ID,
+    // return false if the code is broken
+    static bool decode(const string& code, function<string(unsigned)> getOperand, vector<string>& exprNodeVec);
+};
+
+#endif /* ExprCode_h */
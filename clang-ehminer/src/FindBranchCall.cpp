@@ -14,19 +14,34 @@
 
 #include "FindBranchCall.h"
 #include "DataUtility.h"
+#include "CallDataflow.h"
+#include "CallFilter.h"
+#include "RunStats.h"
 
-// Check whether the char belongs to a variable name or not
-bool isVariableChar(char c){
-    if(c >='0' && c<='9')
-        return true;
-    if(c >='a' && c<='z')
-        return true;
-    if(c >='A' && c<='Z')
-        return true;
-    if(c == '_')
-        return true;
-    
-    return false;
+#include <algorithm>
+
+// Take the original spelling from the file buffer instead of pretty-printing the AST
+bool FindBranchCallVisitor::rawSourceText = false;
+
+// Set whether to take the original spelling as the source code of a stmt
+void FindBranchCallVisitor::setRawSourceText(bool enable){
+    rawSourceText = enable;
+}
+
+// Find the checks of call results by a dataflow analysis on the CFG
+bool FindBranchCallVisitor::dataflowEngine = false;
+
+// Set whether to find the checks of call results by the dataflow engine
+void FindBranchCallVisitor::setDataflowEngine(bool enable){
+    dataflowEngine = enable;
+}
+
+// Record the calls in function_call, call_graph and call_statistic
+bool FindBranchCallVisitor::callStatistic = true;
+
+// Set whether to record the call statistics
+void FindBranchCallVisitor::setCallStatistic(bool enable){
+    callStatistic = enable;
 }
 
 // Get the source code of given stmt
@@ -35,6 +50,21 @@ string FindBranchCallVisitor::getSourceCode(Stmt *stmt){
     if(!stmt)
         return "";
     
+    RunStats::PhaseTimer timer(RunStats::PHASE_SOURCE_CODE);
+    
+    // Slice the file buffer over the range of stmt. When the range is inside
+    // a macro expansion, the spelling is not the code, so we pretty-print it.
+    if(rawSourceText){
+        SourceLocation begin = stmt->getLocStart();
+        SourceLocation end = stmt->getLocEnd();
+        if(begin.isValid() && end.isValid() && begin.isFileID() && end.isFileID()){
+            bool invalid = false;
+            StringRef text = Lexer::getSourceText(CharSourceRange::getTokenRange(begin, end), CI->getSourceManager(), CI->getLangOpts(), &invalid);
+            if(!invalid && !text.empty())
+                return text.str();
+        }
+    }
+    
     std::string s;
     llvm::raw_string_ostream sos(s);
     PrintingPolicy pp(CI->getLangOpts());
@@ -42,23 +72,85 @@ string FindBranchCallVisitor::getSourceCode(Stmt *stmt){
     return sos.str();
 }
 
-// Get the nodes from the expr of branch condition
-vector<string> FindBranchCallVisitor::getExprNodeVec(Expr* expr){
+// Get the absolute path of a file name. The API callStart.printToString(callStart.getManager())
+// is behaving inconsistently, more infomation see
+// http://lists.llvm.org/pipermail/cfe-dev/2016-October/051092.html
+// So, we use makeAbsolutePath, and cache the result for each file of the translation unit.
+const string& FindBranchCallVisitor::getAbsolutePath(const char* fileName){
+    llvm::DenseMap<const char*, string>::iterator it = mAbsolutePathCache.find(fileName);
+    if(it != mAbsolutePathCache.end())
+        return it->second;
+    
+    SmallString<128> fullPath(fileName);
+    CI->getFileManager().makeAbsolutePath(fullPath);
+    return mAbsolutePathCache[fileName] = fullPath.str().str();
+}
+
+// Get the "path:line:column" of a location, the path is absolute
+string FindBranchCallVisitor::getLocFullPath(FullSourceLoc loc){
+    PresumedLoc PLoc = CI->getSourceManager().getPresumedLoc(loc);
+    if(PLoc.isInvalid()){
+        SmallString<128> fullPath(loc.printToString(CI->getSourceManager()));
+        CI->getFileManager().makeAbsolutePath(fullPath);
+        return fullPath.str().str();
+    }
+    
+    string locFullPath = getAbsolutePath(PLoc.getFilename());
+    locFullPath += ':';
+    locFullPath += std::to_string(PLoc.getLine());
+    locFullPath += ':';
+    locFullPath += std::to_string(PLoc.getColumn());
+    return locFullPath;
+}
+
+// Get the absolute path of the file containing a location
+string FindBranchCallVisitor::getFileFullPath(FullSourceLoc loc){
+    PresumedLoc PLoc = CI->getSourceManager().getPresumedLoc(loc);
+    if(PLoc.isInvalid() || strchr(PLoc.getFilename(), ':')){
+        string file = loc.printToString(CI->getSourceManager());
+        SmallString<128> fullPath(file.substr(0, file.find_first_of(':')));
+        CI->getFileManager().makeAbsolutePath(fullPath);
+        return fullPath.str().str();
+    }
+    return getAbsolutePath(PLoc.getFilename());
+}
+
+// Get the ParentMap of current function, the map is a full walk of the
+// function body, so we build it once per function instead of per lookup
+ParentMap& FindBranchCallVisitor::getParentMap(){
+    if(!mParentMap)
+        mParentMap.reset(new ParentMap(root));
+    return *mParentMap;
+}
+
+// Append the nodes of a branch condition to ret, the nodes of each condition are
+// encoded once per function, since nested branches share their outer conditions
+void FindBranchCallVisitor::appendExprNodeVec(Expr* expr, vector<string>& ret){
+    
+    RunStats::PhaseTimer timer(RunStats::PHASE_EXPR_NODE);
+    
+    llvm::DenseMap<Expr*, vector<string>>::iterator it = mExprNodeCache.find(expr);
+    if(it == mExprNodeCache.end()){
+        vector<string> nodes;
+        getExprNodeVec(expr, nodes);
+        it = mExprNodeCache.insert(std::make_pair(expr, std::move(nodes))).first;
+    }
+    ret.insert(ret.end(), it->second.begin(), it->second.end());
+}
+
+// Get the nodes from the expr of branch condition, and append them to ret
+void FindBranchCallVisitor::getExprNodeVec(Expr* expr, vector<string>& ret){
     
-    vector<string> ret;
     expr = expr->IgnoreCasts();
     
     //expr->dump();
     // Three kinds of operators
     if(auto *parenExpr = dyn_cast<ParenExpr >(expr)){
-        vector<string> child = getExprNodeVec(parenExpr->getSubExpr());
-        
-        ret.insert(ret.end(), child.begin(), child.end());
+        getExprNodeVec(parenExpr->getSubExpr(), ret);
     }
     else if(auto *unaryOperator = dyn_cast<UnaryOperator>(expr)){
-        vector<string> child = getExprNodeVec(unaryOperator->getSubExpr());
+        getExprNodeVec(unaryOperator->getSubExpr(), ret);
         
-        ret.insert(ret.end(), child.begin(), child.end());
         string op = "UO";
         op += "_";
         char code[10];
@@ -97,11 +189,8 @@ vector<string> FindBranchCallVisitor::getExprNodeVec(Expr* expr){
         }
     }
     else if(auto *binaryOperator = dyn_cast<BinaryOperator>(expr)){
-        vector<string> lchild = getExprNodeVec(binaryOperator->getLHS());
-        vector<string> rchild = getExprNodeVec(binaryOperator->getRHS());
-        
-        ret.insert(ret.end(), lchild.begin(), lchild.end());
-        ret.insert(ret.end(), rchild.begin(), rchild.end());
+        getExprNodeVec(binaryOperator->getLHS(), ret);
+        getExprNodeVec(binaryOperator->getRHS(), ret);
         
         string op = "BO";
         op += "_";
@@ -113,13 +202,9 @@ vector<string> FindBranchCallVisitor::getExprNodeVec(Expr* expr){
         ret.push_back(op);
     }
     else if(auto *conditionalOperator = dyn_cast<ConditionalOperator>(expr)){
-        vector<string> lchild = getExprNodeVec(conditionalOperator->getCond());
-        vector<string> mchild = getExprNodeVec(conditionalOperator->getTrueExpr());
-        vector<string> rchild = getExprNodeVec(conditionalOperator->getFalseExpr());
-        
-        ret.insert(ret.end(), lchild.begin(), lchild.end());
-        ret.insert(ret.end(), mchild.begin(), mchild.end());
-        ret.insert(ret.end(), rchild.begin(), rchild.end());
+        getExprNodeVec(conditionalOperator->getCond(), ret);
+        getExprNodeVec(conditionalOperator->getTrueExpr(), ret);
+        getExprNodeVec(conditionalOperator->getFalseExpr(), ret);
         ret.push_back(":?");
     }
     
@@ -182,11 +267,8 @@ vector<string> FindBranchCallVisitor::getExprNodeVec(Expr* expr){
     }
     else if(auto *arraySubscriptExpr = dyn_cast<ArraySubscriptExpr>(expr)){
         
-        vector<string> base = getExprNodeVec(arraySubscriptExpr->getBase());
-        vector<string> index = getExprNodeVec(arraySubscriptExpr->getIdx());
-        
-        ret.insert(ret.end(), base.begin(), base.end());
-        ret.insert(ret.end(), index.begin(), index.end());
+        getExprNodeVec(arraySubscriptExpr->getBase(), ret);
+        getExprNodeVec(arraySubscriptExpr->getIdx(), ret);
         
         ret.push_back("BO_ARRAY");
         
@@ -210,8 +292,7 @@ vector<string> FindBranchCallVisitor::getExprNodeVec(Expr* expr){
     else if(auto *memberExpr = dyn_cast<MemberExpr>(expr)){
         ret.push_back(memberExpr->getMemberDecl()->getName().str());
         
-        vector<string> base = getExprNodeVec(memberExpr->getBase());
-        ret.insert(ret.end(), base.begin(), base.end());
+        getExprNodeVec(memberExpr->getBase(), ret);
         
         ret.push_back("BO_MEMBER");
         
@@ -274,8 +355,6 @@ vector<string> FindBranchCallVisitor::getExprNodeVec(Expr* expr){
         cerr<<"Unknown expr: "<<expr->getStmtClassName()<<" @ "<<otherLoc.getExpansionLoc().printToString(CI->getSourceManager())<<endl;
         ret.push_back(getSourceCode(expr));
     }
-    
-    return ret;
 }
 
 // Record call-log/ret pair
@@ -294,7 +373,13 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
     FunctionDecl* callDecl = callExpr->getDirectCallee();
     if(callDecl->getPreviousDecl())
         callDecl = callDecl->getPreviousDecl();
+    
+    // Only the calls of the functions recorded by the config, and of the target functions if any
+    if(!CallFilter::isRecorded(callDecl))
+        return;
     string callName = callDecl->getNameAsString();
+    if(!CallFilter::isTarget(callName))
+        return;
     
     FullSourceLoc callLoc = CI->getASTContext().getFullLoc(callExpr->getLocStart());
     FullSourceLoc callDef = CI->getASTContext().getFullLoc(callDecl->getLocStart());
@@ -304,17 +389,8 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
     callLoc = callLoc.getExpansionLoc();
     callDef = callDef.getSpellingLoc();
     
-    string callLocFile = callLoc.printToString(callLoc.getManager());
-    string callDefFile = callDef.printToString(callDef.getManager());
-    callDefFile = callDefFile.substr(0, callDefFile.find_first_of(':'));
-    
-    // The API callStart.printToString(callStart.getManager()) is behaving inconsistently,
-    // more infomation see http://lists.llvm.org/pipermail/cfe-dev/2016-October/051092.html
-    // So, we use makeAbsolutePath.
-    SmallString<128> callLocFullPath(callLocFile);
-    CI->getFileManager().makeAbsolutePath(callLocFullPath);
-    SmallString<128> callDefFullPath(callDefFile);
-    CI->getFileManager().makeAbsolutePath(callDefFullPath);
+    string callLocFullPath = getLocFullPath(callLoc);
+    string callDefFullPath = getFileFullPath(callDef);
     
     // Collect branch condition information
     vector<string> exprNodeVec;
@@ -327,8 +403,7 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
     
     for(unsigned i = 0; i < mBranchCondVec.size(); i++){
         // Get the overall expr node vector
-        vector<string> tmp = getExprNodeVec(mBranchCondVec[i]);
-        exprNodeVec.insert(exprNodeVec.end(), tmp.begin(), tmp.end());
+        appendExprNodeVec(mBranchCondVec[i], exprNodeVec);
         if(mPathNumberVec[i] >= 10000){
             mPathNumberVec[i] -= 10000;
             exprNodeVec.push_back("UO_9_!");
@@ -342,8 +417,7 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
                 auto* mCaseLabel = caseStmt->getLHS();
             
                 if(mCaseLabel){
-                    tmp = getExprNodeVec(mCaseLabel);
-                    exprNodeVec.insert(exprNodeVec.end(), tmp.begin(), tmp.end());
+                    appendExprNodeVec(mCaseLabel, exprNodeVec);
                     exprNodeVec.push_back("BO_13_==");
                     caseLabelStr.push_back(getSourceCode(mCaseLabel));
                 }
@@ -366,8 +440,8 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
     // Arrange the branch info elements
     BranchInfo branchInfo;
     branchInfo.callName = callName;
-    branchInfo.callDefLoc = callDefFullPath.str();
-    branchInfo.callID = callLocFullPath.str();
+    branchInfo.callDefLoc = callDefFullPath;
+    branchInfo.callID = callLocFullPath;
     branchInfo.callStr = getSourceCode(callExpr);
     for(unsigned i = 0; i < mReturnNameVec.size(); i++){
         branchInfo.callReturnVec.push_back(mReturnNameVec[i]);
@@ -380,11 +454,6 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
     branchInfo.caseLabelVec = caseLabelStr;
     branchInfo.pathNumberVec = mPathNumberVec;
     
-    if(//branchInfo.callDefLoc.find("/usr") == string::npos ||
-       branchInfo.callName.find("operator") != string::npos ||
-       branchInfo.callName.find("__builtin") != string::npos)
-        return;
-
     // Find a call-return pair
     if(retStmt != nullptr){
         
@@ -395,14 +464,12 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
         }
         
         retLoc = retLoc.getExpansionLoc();
-        string retLocFile = retLoc.printToString(retLoc.getManager());
-        SmallString<128> retLocFullPath(retLocFile);
-        CI->getFileManager().makeAbsolutePath(retLocFullPath);
+        string retLocFullPath = getLocFullPath(retLoc);
         
         // Stroe the call-return info to callData
         branchInfo.logName = "return";
         branchInfo.logDefLoc = "-";
-        branchInfo.logID = retLocFullPath.str();
+        branchInfo.logID = retLocFullPath;
         branchInfo.logStr = getSourceCode(retStmt);
         branchInfo.logArgVec.push_back(getSourceCode(retStmt->getRetValue()));
         branchInfo.logRetType = "-";
@@ -410,8 +477,8 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
         callData.addBranchCall(branchInfo);
         
         // Store the post-branch and pre-branch info to callData
-        //callData.addPostbranchCall(callName, callLocFullPath.str(), callDefFullPath.str(), "return", "-");
-        //callData.addPrebranchCall(callName, callLocFullPath.str(), callDefFullPath.str(), "return", "-");
+        //callData.addPostbranchCall(callName, callLocFullPath, callDefFullPath, "return", "-");
+        //callData.addPrebranchCall(callName, callLocFullPath, callDefFullPath, "return", "-");
     }
     // Find a call-continue/break/goto pair
     else if(otherStmt != nullptr){
@@ -423,9 +490,7 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
         }
         
         loc = loc.getExpansionLoc();
-        string locFile = loc.printToString(loc.getManager());
-        SmallString<128> locFullPath(locFile);
-        CI->getFileManager().makeAbsolutePath(locFullPath);
+        string locFullPath = getLocFullPath(loc);
         
         // Stroe the call-continue/break/goto info to callData
         string stmtstring = "";
@@ -439,15 +504,15 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
             stmtstring = "unknown";
         branchInfo.logName = stmtstring;
         branchInfo.logDefLoc = "-";
-        branchInfo.logID = locFullPath.str();
+        branchInfo.logID = locFullPath;
         branchInfo.logStr = getSourceCode(otherStmt);
         branchInfo.logRetType = "-";
         branchInfo.logArgTypeVec.push_back("-");
         callData.addBranchCall(branchInfo);
         
         // Store the post-branch and pre-branch info to callData
-        //callData.addPostbranchCall(callName, callLocFullPath.str(), callDefFullPath.str(), stmtstring, "-");
-        //callData.addPrebranchCall(callName, callLocFullPath.str(), callDefFullPath.str(), stmtstring, "-");
+        //callData.addPostbranchCall(callName, callLocFullPath, callDefFullPath, stmtstring, "-");
+        //callData.addPrebranchCall(callName, callLocFullPath, callDefFullPath, stmtstring, "-");
     }
     // Find a call-log pair
     else{
@@ -469,19 +534,13 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
         logLoc = logLoc.getExpansionLoc();
         logDef = logDef.getSpellingLoc();
         
-        string logLocFile = logLoc.printToString(logLoc.getManager());
-        string logDefFile = logDef.printToString(logDef.getManager());
-        logDefFile = logDefFile.substr(0, logDefFile.find_first_of(':'));
-        
-        SmallString<128> logLocFullPath(logLocFile);
-        CI->getFileManager().makeAbsolutePath(logLocFullPath);
-        SmallString<128> logDefFullPath(logDefFile);
-        CI->getFileManager().makeAbsolutePath(logDefFullPath);
+        string logLocFullPath = getLocFullPath(logLoc);
+        string logDefFullPath = getFileFullPath(logDef);
         
         // Stroe the call-log info to callData
         branchInfo.logName = logName;
-        branchInfo.logDefLoc = logDefFullPath.str();
-        branchInfo.logID = logLocFullPath.str();
+        branchInfo.logDefLoc = logDefFullPath;
+        branchInfo.logID = logLocFullPath;
         branchInfo.logStr = getSourceCode(logExpr);
         for(unsigned i = 0; i < logExpr->getNumArgs(); i++)
             branchInfo.logArgVec.push_back(getSourceCode(logExpr->getArg(i)));
@@ -492,19 +551,19 @@ void FindBranchCallVisitor::recordBranchCall(CallExpr *callExpr, CallExpr *logEx
         callData.addBranchCall(branchInfo);
         
         // Store the post-branch and pre-branch info to callData
-        //callData.addPostbranchCall(callName, callLocFullPath.str(), callDefFullPath.str(), logName, logDefFullPath.str());
+        //callData.addPostbranchCall(callName, callLocFullPath, callDefFullPath, logName, logDefFullPath);
         //pair<CallExpr*, string> mypair = make_pair(callExpr, logName);
         // For "if(foo()) bar(); bar();", ignore the second "bar()"
         //if(hasSameLog[mypair] == false){
         //    hasSameLog[mypair] = true;
-        //    callData.addPrebranchCall(callName, callLocFullPath.str(), callDefFullPath.str(), logName, logDefFullPath.str());
+        //    callData.addPrebranchCall(callName, callLocFullPath, callDefFullPath, logName, logDefFullPath);
         //}
     }
     return;
 }
 
 // Search post-branch call site in given stmt and invoke the recordCallLog method
-void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr, string keyword, int deep){
+void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr, const KeyDeclSet& keyVariables, int deep){
 
     // generally speaking, there are not too many nested checks, like
     // ret = foo(); if(ret!=0)if(ret!=1)if(ret!=2)if(ret!=3)if(ret!=4)log();
@@ -525,11 +584,10 @@ void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr,
 
     // Search recursively for nested if and switch branch
     if(dyn_cast<IfStmt>(stmt) || dyn_cast<SwitchStmt>(stmt)){
-        if(keyword != ""){
-            vector<string> onekey;
-            onekey.push_back(keyword);
-            searchCheck(stmt, callExpr, onekey, deep + 1);
-        }
+        if(mUseDataflow)
+            searchDataflowCheck(stmt, callExpr, deep + 1);
+        else if(!keyVariables.empty())
+            searchCheck(stmt, callExpr, keyVariables, deep + 1);
         return;
     }
     
@@ -540,8 +598,8 @@ void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr,
     // The non-reaching definition will be ignored, bug here
     if(auto *bo = dyn_cast<BinaryOperator>(stmt)){
         if(bo->getOpcode() == BO_Assign){
-            string assignName = getSourceCode(bo->getLHS());
-            if(keyword != "" && assignName == keyword)
+            const ValueDecl* assignDecl = CallDataflow::getKeyDecl(bo->getLHS());
+            if(assignDecl && keyVariables.count(assignDecl))
                 return;
         }
     }
@@ -553,27 +611,29 @@ void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr,
     //  if(flag==1)
     //    log();
     //\code
-    string flagname = "";
+    const ValueDecl* flagDecl = nullptr;
     string rightvalue = "";
     if(auto *bo = dyn_cast<BinaryOperator>(stmt)){
         if(bo->getOpcode() == BO_Assign){
             if(dyn_cast<IntegerLiteral>(bo->getRHS()->IgnoreCasts()) ||
                dyn_cast<CXXBoolLiteralExpr>(bo->getRHS()->IgnoreCasts())){
-                flagname = getSourceCode(bo->getLHS()->IgnoreCasts());
+                flagDecl = CallDataflow::getKeyDecl(bo->getLHS());
                 rightvalue = getSourceCode(bo->getRHS()->IgnoreCasts());
             }
             
             if(auto *declRefExpr = dyn_cast<DeclRefExpr>(bo->getRHS()->IgnoreCasts()))
                 if(dyn_cast<EnumConstantDecl>(declRefExpr->getFoundDecl())){
-                    flagname = getSourceCode(bo->getLHS()->IgnoreCasts());
+                    flagDecl = CallDataflow::getKeyDecl(bo->getLHS());
                     rightvalue = getSourceCode(bo->getRHS()->IgnoreCasts());
                 }
         }
     }
     string assignexpr = "";
-    if(flagname != ""){
+    if(flagDecl){
+        KeyDeclSet flagKey;
+        flagKey.insert(flagDecl);
         assignexpr = getSourceCode(stmt);
-        ParentMap PM(root);
+        ParentMap& PM = getParentMap();
         Stmt* me = stmt;
         Stmt* myfather = PM.getParent(me);
         int level = 0;
@@ -599,18 +659,10 @@ void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr,
                     
                     // For IfStmt
                     if(IfStmt *ifStmt = dyn_cast<IfStmt>(brother)){
-                        string condstr = getSourceCode(ifStmt->getCond());
-                        if(condstr != flagname){
-                            size_t pos = condstr.find(flagname);
-                            unsigned keylen = flagname.size();
-                            unsigned conlen = condstr.size();
-                            if(pos == string::npos)
-                                continue;
-                            if(pos + keylen < conlen && isVariableChar(condstr[pos+keylen]))
-                                continue;
-                            if(pos > 0 && isVariableChar(condstr[pos-1]))
-                                continue;
-                        }
+                        KeyDeclSet used;
+                        getUsedKeyDecls(ifStmt->getCond(), flagKey, used);
+                        if(used.empty())
+                            continue;
                         
                         //TODO: use z3 solver the detemine whether negate the condition or not
                         //llvm::errs()<<flagname<<"\n";
@@ -649,24 +701,16 @@ void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr,
                             case z3::unknown: std::cout << "unknown\n"; break;
                         }*/
                         
-                        searchPostBranchCall(ifStmt->getThen(), callExpr, "", 4);
-                        searchPostBranchCall(ifStmt->getElse(), callExpr, "", 4);
+                        searchPostBranchCall(ifStmt->getThen(), callExpr, KeyDeclSet(), 4);
+                        searchPostBranchCall(ifStmt->getElse(), callExpr, KeyDeclSet(), 4);
                     }
                     
                     // For SwitchStmt
                     if(SwitchStmt *switchStmt = dyn_cast<SwitchStmt>(brother)){
-                        string condstr = getSourceCode(switchStmt->getCond());
-                        if(condstr != flagname){
-                            size_t pos = condstr.find(flagname);
-                            unsigned keylen = flagname.size();
-                            unsigned conlen = condstr.size();
-                            if(pos == string::npos)
-                                continue;
-                            if(pos + keylen < conlen && isVariableChar(condstr[pos+keylen]))
-                                continue;
-                            if(pos > 0 && isVariableChar(condstr[pos-1]))
-                                continue;
-                        }
+                        KeyDeclSet used;
+                        getUsedKeyDecls(switchStmt->getCond(), flagKey, used);
+                        if(used.empty())
+                            continue;
                         for (SwitchCase *SC = switchStmt->getSwitchCaseList(); SC; SC = SC->getNextSwitchCase()){
                             if(auto* caseStmt = dyn_cast<CaseStmt>(SC)){
                                 auto* mCaseLabel = caseStmt->getLHS();
@@ -678,7 +722,7 @@ void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr,
                                     mPathNumberVec.pop_back();
                                     mPathNumberVec.push_back(pathnumber + 10000);
                                 }
-                                searchPostBranchCall(SC->getSubStmt(), callExpr, "", 4);
+                                searchPostBranchCall(SC->getSubStmt(), callExpr, KeyDeclSet(), 4);
                             }
                         }
                     }
@@ -691,7 +735,7 @@ void FindBranchCallVisitor::searchPostBranchCall(Stmt *stmt, CallExpr* callExpr,
     
     for(auto it = stmt->child_begin(); it != stmt->child_end(); ++it){
         if(Stmt *child = *it)
-            searchPostBranchCall(child, callExpr, keyword, deep);
+            searchPostBranchCall(child, callExpr, keyVariables, deep);
     }
     
     return;
@@ -741,9 +785,27 @@ vector<Expr*> FindBranchCallVisitor::getSubCondition(Expr *expr){
     return ret;
 }
 
+// Get the key variables used in given stmt, by the identity of their declarations
+void FindBranchCallVisitor::getUsedKeyDecls(const Stmt* stmt, const KeyDeclSet& keyVariables, KeyDeclSet& used){
+    
+    if(!stmt)
+        return;
+    
+    const ValueDecl* decl = nullptr;
+    if(auto *declRefExpr = dyn_cast<DeclRefExpr>(stmt))
+        decl = declRefExpr->getDecl();
+    if(auto *memberExpr = dyn_cast<MemberExpr>(stmt))
+        decl = memberExpr->getMemberDecl();
+    if(decl && keyVariables.count(decl))
+        used.insert(decl);
+    
+    for(Stmt::const_child_iterator it = stmt->child_begin(); it != stmt->child_end(); ++it)
+        getUsedKeyDecls(*it, keyVariables, used);
+}
+
 // Search check candidate, we only care about if and switch
 // input: branch statement, function call (if any), key variables (if any), deep of check condition
-void FindBranchCallVisitor::searchCheck(Stmt* stmt, CallExpr* callExpr, vector<string> keyVariables, int deep){
+void FindBranchCallVisitor::searchCheck(Stmt* stmt, CallExpr* callExpr, const KeyDeclSet& keyVariables, int deep){
 
     if(deep >= 5)
         return;
@@ -759,10 +821,10 @@ void FindBranchCallVisitor::searchCheck(Stmt* stmt, CallExpr* callExpr, vector<s
                     mBranchCondVec.push_back(subcond[i]);
                     mPathNumberVec.push_back(0);
                     mSwitchCaseVec.push_back(nullptr);
-                    searchPostBranchCall(ifStmt->getThen(), call, "", deep);
+                    searchPostBranchCall(ifStmt->getThen(), call, KeyDeclSet(), deep);
                     mPathNumberVec.pop_back();
                     mPathNumberVec.push_back(1);
-                    searchPostBranchCall(ifStmt->getElse(), call, "", deep);
+                    searchPostBranchCall(ifStmt->getElse(), call, KeyDeclSet(), deep);
                     mBranchCondVec.pop_back();
                     mPathNumberVec.pop_back();
                     mSwitchCaseVec.pop_back();
@@ -770,36 +832,23 @@ void FindBranchCallVisitor::searchCheck(Stmt* stmt, CallExpr* callExpr, vector<s
                 continue;
             }
             
-            string condString = getSourceCode(subcond[i]);
-            // check whether control dependent
-            for(unsigned j = 0; j < keyVariables.size(); j++){
-                if(keyVariables[j] == "")
-                    continue;
-                
-                if(condString != keyVariables[j]){
-                    size_t pos = condString.find(keyVariables[j]);
-                    unsigned keylen = keyVariables[j].size();
-                    unsigned conlen = condString.size();
-                    if(pos == string::npos)
-                        continue;
-                    if(pos + keylen < conlen && isVariableChar(condString[pos+keylen]))
-                        continue;
-                    if(pos > 0 && isVariableChar(condString[pos-1]))
-                        continue;
-                }
-                
-                // Search for log in both 'then body' and 'else body'
-                mBranchCondVec.push_back(subcond[i]);
-                mPathNumberVec.push_back(0);
-                mSwitchCaseVec.push_back(nullptr);
-                searchPostBranchCall(ifStmt->getThen(), callExpr, keyVariables[j], deep);
-                mPathNumberVec.pop_back();
-                mPathNumberVec.push_back(1);
-                searchPostBranchCall(ifStmt->getElse(), callExpr, keyVariables[j], deep);
-                mBranchCondVec.pop_back();
-                mPathNumberVec.pop_back();
-                mSwitchCaseVec.pop_back();
-            }
+            // check whether control dependent, and search once for all the key variables used
+            KeyDeclSet used;
+            getUsedKeyDecls(subcond[i], keyVariables, used);
+            if(used.empty())
+                continue;
+            
+            // Search for log in both 'then body' and 'else body'
+            mBranchCondVec.push_back(subcond[i]);
+            mPathNumberVec.push_back(0);
+            mSwitchCaseVec.push_back(nullptr);
+            searchPostBranchCall(ifStmt->getThen(), callExpr, used, deep);
+            mPathNumberVec.pop_back();
+            mPathNumberVec.push_back(1);
+            searchPostBranchCall(ifStmt->getElse(), callExpr, used, deep);
+            mBranchCondVec.pop_back();
+            mPathNumberVec.pop_back();
+            mSwitchCaseVec.pop_back();
         }
     }
     
@@ -815,7 +864,7 @@ void FindBranchCallVisitor::searchCheck(Stmt* stmt, CallExpr* callExpr, vector<s
                     mBranchCondVec.push_back(switchStmt->getCond());
                     mPathNumberVec.push_back(pathnum);
                     mSwitchCaseVec.push_back(SC);
-                    searchPostBranchCall(SC->getSubStmt(), call, "", deep);
+                    searchPostBranchCall(SC->getSubStmt(), call, KeyDeclSet(), deep);
                     mBranchCondVec.pop_back();
                     mPathNumberVec.pop_back();
                     mSwitchCaseVec.pop_back();
@@ -824,31 +873,186 @@ void FindBranchCallVisitor::searchCheck(Stmt* stmt, CallExpr* callExpr, vector<s
             }
         }
         
-        string condString = getSourceCode(switchStmt->getCond());
-        // check whether control dependent
-        for(unsigned i = 0; i < keyVariables.size(); i++){
-            if(keyVariables[i] == "")
-                continue;
-            
-            if(condString != keyVariables[i]){
-                size_t pos = condString.find(keyVariables[i]);
-                unsigned keylen = keyVariables[i].size();
-                unsigned conlen = condString.size();
-                if(pos == string::npos)
+        // check whether control dependent, and search once for all the key variables used
+        KeyDeclSet used;
+        getUsedKeyDecls(switchStmt->getCond(), keyVariables, used);
+        if(!used.empty()){
+            // Search for log in switch body
+            int pathnum = 0;
+            for (SwitchCase *SC = switchStmt->getSwitchCaseList(); SC; SC = SC->getNextSwitchCase()){
+                mBranchCondVec.push_back(switchStmt->getCond());
+                mPathNumberVec.push_back(pathnum);
+                mSwitchCaseVec.push_back(SC);
+                searchPostBranchCall(SC->getSubStmt(), callExpr, used, deep);
+                mBranchCondVec.pop_back();
+                mPathNumberVec.pop_back();
+                mSwitchCaseVec.pop_back();
+                pathnum++;
+            }
+        }
+    }
+}
+
+// Find the checks of call results in the function body by the dataflow engine,
+// a sub-condition is a check of a call if it uses a variable related to the call
+bool FindBranchCallVisitor::findDataflowChecks(FunctionDecl* functionDecl, Stmt* body){
+    
+    mDataflowChecks.clear();
+    mDataflowCheckOrder.clear();
+    
+    CallDataflow dataflow;
+    if(!dataflow.run(functionDecl, body, CI->getASTContext()))
+        return false;
+    
+    const vector<pair<Stmt*, CallDataflow::CallFacts>>& branchFacts = dataflow.getBranchFacts();
+    for(unsigned i = 0; i < branchFacts.size(); i++){
+        Stmt* stmt = branchFacts[i].first;
+        const CallDataflow::CallFacts& facts = branchFacts[i].second;
+        
+        vector<Expr*> subcond;
+        if(IfStmt *ifStmt = dyn_cast<IfStmt>(stmt))
+            subcond = getSubCondition(ifStmt->getCond());
+        if(SwitchStmt *switchStmt = dyn_cast<SwitchStmt>(stmt))
+            subcond.push_back(switchStmt->getCond());
+        
+        vector<DataflowCheck> checks;
+        for(unsigned j = 0; j < subcond.size(); j++){
+            // The calls related to the variables used in the sub-condition
+            set<const ValueDecl*> keys;
+            CallDataflow::collectKeyDecls(subcond[j], keys);
+            set<const CallExpr*> calls;
+            for(set<const ValueDecl*>::iterator key = keys.begin(); key != keys.end(); ++key){
+                CallDataflow::CallFacts::const_iterator it = facts.find(*key);
+                if(it == facts.end())
                     continue;
-                if(pos + keylen < conlen && isVariableChar(condString[pos+keylen]))
+                for(set<CallDataflow::CallFact>::const_iterator fact = it->second.begin(); fact != it->second.end(); ++fact)
+                    calls.insert(fact->callExpr);
+            }
+            
+            for(set<const CallExpr*>::iterator call = calls.begin(); call != calls.end(); ++call){
+                unsigned k = 0;
+                while(k < checks.size() && checks[k].callExpr != *call)
+                    k++;
+                if(k == checks.size()){
+                    DataflowCheck check;
+                    check.callExpr = const_cast<CallExpr*>(*call);
+                    checks.push_back(check);
+                }
+                checks[k].conds.push_back(subcond[j]);
+            }
+        }
+        if(checks.empty())
+            continue;
+        
+        // The pointers vary between runs, so sort the calls and the variables by their locations
+        sort(checks.begin(), checks.end(), [](const DataflowCheck& a, const DataflowCheck& b){
+            return a.callExpr->getLocStart().getRawEncoding() < b.callExpr->getLocStart().getRawEncoding();
+        });
+        for(unsigned j = 0; j < checks.size(); j++){
+            // The variables holding the result of the call, like mReturnNameVec of the name search
+            vector<pair<unsigned, string>> returnNames;
+            CallDataflow::CallFact result = {checks[j].callExpr, true};
+            for(CallDataflow::CallFacts::const_iterator it = facts.begin(); it != facts.end(); ++it)
+                if(it->second.count(result))
+                    returnNames.push_back(make_pair(it->first->getLocation().getRawEncoding(), it->first->getNameAsString()));
+            sort(returnNames.begin(), returnNames.end());
+            for(unsigned k = 0; k < returnNames.size(); k++)
+                checks[j].returnNames.push_back(returnNames[k].second);
+            if(checks[j].returnNames.empty())
+                checks[j].returnNames.push_back("-");
+        }
+        
+        mDataflowChecks[stmt] = checks;
+        mDataflowCheckOrder.push_back(stmt);
+    }
+    
+    return true;
+}
+
+// Search post-branch call sites of the checks found by the dataflow engine
+void FindBranchCallVisitor::searchDataflowChecks(){
+    
+    ParentMap& parentMap = getParentMap();
+    for(unsigned i = 0; i < mDataflowCheckOrder.size(); i++){
+        Stmt* stmt = mDataflowCheckOrder[i];
+        vector<DataflowCheck>& checks = mDataflowChecks.find(stmt)->second;
+        for(unsigned j = 0; j < checks.size(); j++){
+            
+            // A check in a branch of another check on the same call is searched from the
+            // outer one, searchPostBranchCall reaches it unless a loop or an if/switch
+            // unrelated to the call is in between
+            bool nested = false;
+            Stmt* me = stmt;
+            for(Stmt* father = parentMap.getParent(me); father; me = father, father = parentMap.getParent(me)){
+                if(dyn_cast<WhileStmt>(father) || dyn_cast<ForStmt>(father))
+                    break;
+                
+                Expr* cond = nullptr;
+                if(IfStmt *ifStmt = dyn_cast<IfStmt>(father))
+                    cond = ifStmt->getCond();
+                else if(SwitchStmt *switchStmt = dyn_cast<SwitchStmt>(father))
+                    cond = switchStmt->getCond();
+                else
                     continue;
-                if(pos > 0 && isVariableChar(condString[pos-1]))
+                if(me == cond)
                     continue;
+                
+                llvm::DenseMap<Stmt*, vector<DataflowCheck>>::iterator it = mDataflowChecks.find(father);
+                if(it != mDataflowChecks.end()){
+                    for(unsigned k = 0; k < it->second.size(); k++)
+                        if(it->second[k].callExpr == checks[j].callExpr)
+                            nested = true;
+                }
+                break;
             }
+            if(nested)
+                continue;
             
+            mReturnNameVec = checks[j].returnNames;
+            searchDataflowCheck(stmt, checks[j].callExpr, 0);
+        }
+    }
+}
+
+// Search post-branch call sites of a check on the result of callExpr, if stmt is one
+void FindBranchCallVisitor::searchDataflowCheck(Stmt* stmt, CallExpr* callExpr, int deep){
+    
+    if(deep >= 5)
+        return;
+    
+    llvm::DenseMap<Stmt*, vector<DataflowCheck>>::iterator it = mDataflowChecks.find(stmt);
+    if(it == mDataflowChecks.end())
+        return;
+    
+    for(unsigned i = 0; i < it->second.size(); i++){
+        const DataflowCheck& check = it->second[i];
+        if(check.callExpr != callExpr)
+            continue;
+        
+        if(IfStmt *ifStmt = dyn_cast<IfStmt>(stmt)){
+            for(unsigned j = 0; j < check.conds.size(); j++){
+                // Search for log in both 'then body' and 'else body'
+                mBranchCondVec.push_back(check.conds[j]);
+                mPathNumberVec.push_back(0);
+                mSwitchCaseVec.push_back(nullptr);
+                searchPostBranchCall(ifStmt->getThen(), callExpr, KeyDeclSet(), deep);
+                mPathNumberVec.pop_back();
+                mPathNumberVec.push_back(1);
+                searchPostBranchCall(ifStmt->getElse(), callExpr, KeyDeclSet(), deep);
+                mBranchCondVec.pop_back();
+                mPathNumberVec.pop_back();
+                mSwitchCaseVec.pop_back();
+            }
+        }
+        
+        if(SwitchStmt *switchStmt = dyn_cast<SwitchStmt>(stmt)){
             // Search for log in switch body
             int pathnum = 0;
             for (SwitchCase *SC = switchStmt->getSwitchCaseList(); SC; SC = SC->getNextSwitchCase()){
                 mBranchCondVec.push_back(switchStmt->getCond());
                 mPathNumberVec.push_back(pathnum);
                 mSwitchCaseVec.push_back(SC);
-                searchPostBranchCall(SC->getSubStmt(), callExpr, keyVariables[i], deep);
+                searchPostBranchCall(SC->getSubStmt(), callExpr, KeyDeclSet(), deep);
                 mBranchCondVec.pop_back();
                 mPathNumberVec.pop_back();
                 mSwitchCaseVec.pop_back();
@@ -866,8 +1070,8 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
     
     fatherStmt[stmt] = father;
     
-    // For callexpr, get statistics.
-    if(CallExpr* callExpr = dyn_cast<CallExpr>(stmt)){
+    // For callexpr, get statistics, unless the first pass has them.
+    if(CallExpr* callExpr = callStatistic ? dyn_cast<CallExpr>(stmt) : nullptr){
         if(FunctionDecl* callFunctionDecl = callExpr->getDirectCallee()){
             
             // For foo() in cat(){}, get its decl in foo.h
@@ -902,43 +1106,38 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
                 callDef = callDef.getSpellingLoc();
                 funcDef = funcDef.getSpellingLoc();
                 
-                string callLocFile = callLoc.printToString(callLoc.getManager());
-                string callDefFile = callDef.printToString(callDef.getManager());
-                string funcDefFile = funcDef.printToString(funcDef.getManager());
-                
-                string callStr = getSourceCode(callExpr);
-                
-                callDefFile = callDefFile.substr(0, callDefFile.find_first_of(':'));
-                funcDefFile = funcDefFile.substr(0, funcDefFile.find_first_of(':'));
-                
-                // The API callStart.printToString(callStart.getManager()) is behaving inconsistently,
-                // more infomation see http://lists.llvm.org/pipermail/cfe-dev/2016-October/051092.html
-                // So, we use makeAbsolutePath.
-                SmallString<128> callLocFullPath(callLocFile);
-                CI->getFileManager().makeAbsolutePath(callLocFullPath);
-                SmallString<128> callDefFullPath(callDefFile);
-                CI->getFileManager().makeAbsolutePath(callDefFullPath);
-                SmallString<128> funcDefFullPath(funcDefFile);
-                CI->getFileManager().makeAbsolutePath(funcDefFullPath);
+                string callLocFullPath = getLocFullPath(callLoc);
+                string callDefFullPath = getFileFullPath(callDef);
+                string funcDefFullPath = getFileFullPath(funcDef);
                 
                 // Store the call information into CallData
                 CallData callData;
                 
-                if(//callDefFullPath.str().find("/usr") != string::npos &&
-                   callName.find("operator") == string::npos &&
-                   callName.find("__builtin") == string::npos)
-                    callData.addFunctionCall(callName, callLocFullPath.str(), callDefFullPath.str(), callStr);
+                // The source code of the call is only built if the call is recorded,
+                // the call graph has all the calls
+                if(//callDefFullPath.find("/usr") != string::npos &&
+                   CallFilter::isRecorded(callFunctionDecl))
+                    callData.addFunctionCall(callName, callLocFullPath, callDefFullPath, getSourceCode(callExpr));
                 
-                string callinfo = funcName + funcDefFullPath.str().str() + callName + callDefFullPath.str().str();
+                string callinfo = funcName + funcDefFullPath + callName + callDefFullPath;
                 // Remove the duplicate edges in call graph
                 if(hasRecorded[callinfo] == false){
                     hasRecorded[callinfo] = true;
-                    callData.addCallGraph(funcName, funcDefFullPath.str(), callName, callDefFullPath.str(), callLocFullPath.str(), funcSize);
+                    callData.addCallGraph(funcName, funcDefFullPath, callName, callDefFullPath, callLocFullPath, funcSize);
                 }
             }
         }
     }
     
+    // A function without target calls has no check to search
+    if(mSkipBranchSearch){
+        for(Stmt::child_iterator it = stmt->child_begin(); it != stmt->child_end(); ++it){
+            if(Stmt *child = *it)
+                travelStmt(child, stmt);
+        }
+        return;
+    }
+    
     mBranchCondVec.clear();
     mPathNumberVec.clear();
     mSwitchCaseVec.clear();
@@ -952,8 +1151,7 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
     // Find if(foo()), stmt is located in the condexpr of ifstmt
     if(IfStmt *ifStmt = dyn_cast<IfStmt>(father)){
         if(ifStmt->getCond() == stmt){
-            vector<string> nokeys;
-            searchCheck(father, nullptr, nokeys, 0);
+            searchCheck(father, nullptr, KeyDeclSet(), 0);
         }
     }
     
@@ -967,8 +1165,7 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
     // Find switch(foo()), stmt is located in the condexpr of switchstmt
     if(SwitchStmt *switchStmt = dyn_cast<SwitchStmt>(father)){
         if(switchStmt->getCond() == stmt){
-            vector<string> nokeys;
-            searchCheck(father, nullptr, nokeys, 0);
+            searchCheck(father, nullptr, KeyDeclSet(), 0);
         }
     }
     
@@ -981,6 +1178,7 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
 
     CallExpr* callExpr = nullptr;
     string returnName = "";
+    const ValueDecl* returnDecl = nullptr;
     
     // Find 'int ret = foo()', when stmt = 'DeclStmt' and DeclInit == 'callexpr'
     if(DeclStmt *declStmt = dyn_cast<DeclStmt>(stmt)){
@@ -988,6 +1186,7 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
             if(VarDecl *valDecl = dyn_cast<VarDecl>(declStmt->getSingleDecl())){
                 if(valDecl->getInit() && dyn_cast<CallExpr>(valDecl->getInit()->IgnoreCasts())){
                     returnName = valDecl->getName();
+                    returnDecl = valDecl;
                     callExpr = dyn_cast<CallExpr>(valDecl->getInit()->IgnoreCasts());
                 }
             }
@@ -1000,30 +1199,32 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
             if(Expr *expr = binaryOperator->getRHS()){
                 if(dyn_cast<CallExpr>(expr->IgnoreCasts())){
                     returnName = getSourceCode(binaryOperator->getLHS());
+                    returnDecl = CallDataflow::getKeyDecl(binaryOperator->getLHS());
                     callExpr = dyn_cast<CallExpr>(expr->IgnoreCasts());
                 }
             }
         }
     }
     
-    // Found 'ret = foo();' OR 'int ret = foo();'
-    if(callExpr != nullptr && returnName != ""){
+    // Found 'ret = foo();' OR 'int ret = foo();', the dataflow engine finds the checks itself
+    if(callExpr != nullptr && returnName != "" && !mUseDataflow){
         
-        // Collect arguments of callexpr
-        vector<string> keyVariables;
-        keyVariables.clear();
+        // Collect arguments of callexpr, the key variables are identified by their declarations
+        KeyDeclSet keyVariables;
         mReturnNameVec.clear();
+        // The declarations of the names in mReturnNameVec
+        vector<const ValueDecl*> returnDeclVec;
         
         while(returnName.size() > 0 && (returnName[0] == '&' || returnName[0] == '*'))
             returnName = returnName.substr(1, string::npos);
         mReturnNameVec.push_back(returnName);
-        keyVariables.push_back(returnName);
+        returnDeclVec.push_back(returnDecl);
+        if(returnDecl)
+            keyVariables.insert(returnDecl);
         for(unsigned i = 0; i < callExpr->getNumArgs(); i++){
-            string argstr = getSourceCode(callExpr->getArg(i));
-            // Remove the & and *, e.g., &error -> error
-            while(argstr.size() > 0 && (argstr[0] == '&' || argstr[0] == '*'))
-                argstr = argstr.substr(1, string::npos);
-            keyVariables.push_back(argstr);
+            // The & and * are removed, e.g., &error -> error
+            if(const ValueDecl* argDecl = CallDataflow::getKeyDecl(callExpr->getArg(i)))
+                keyVariables.insert(argDecl);
         }
         
         // Deal with the path union situation
@@ -1053,8 +1254,11 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
                             string newname = getSourceCode(binaryOperator->getLHS());
                             while(newname.size() > 0 && (newname[0] == '&' || newname[0] == '*'))
                                 newname = newname.substr(1, string::npos);
+                            const ValueDecl* newDecl = CallDataflow::getKeyDecl(binaryOperator->getLHS());
                             mReturnNameVec.push_back(newname);
-                            keyVariables.push_back(newname);
+                            returnDeclVec.push_back(newDecl);
+                            if(newDecl)
+                                keyVariables.insert(newDecl);
                         }
                     }
                 }
@@ -1069,7 +1273,8 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
                             while(newname.size() > 0 && (newname[0] == '&' || newname[0] == '*'))
                                 newname = newname.substr(1, string::npos);
                             mReturnNameVec.push_back(newname);
-                            keyVariables.push_back(newname);
+                            returnDeclVec.push_back(valDecl);
+                            keyVariables.insert(valDecl);
                         }
                     }
                 }
@@ -1104,30 +1309,29 @@ void FindBranchCallVisitor::travelStmt(Stmt *stmt, Stmt *father){
                     if(BinaryOperator *bo = dyn_cast<BinaryOperator>(brother)){
                         if(bo->getOpcode() == BO_Assign){
                             // The non-reaching definition will be ignored: a=foo(); a=b;
-                            string leftname = getSourceCode(bo->getLHS());
-                            while(leftname.size() > 0 && (leftname[0] == '&' || leftname[0] == '*'))
-                                leftname = leftname.substr(1, string::npos);
-                            for(vector<string>::iterator it=keyVariables.begin();it!=keyVariables.end();){
-                                if(leftname != "" && *it == leftname)
-                                    it=keyVariables.erase(it);
-                                else
-                                    ++it;
-                            }
-                            for(vector<string>::iterator it=mReturnNameVec.begin();it!=mReturnNameVec.end();){
-                                if(leftname != "" && *it == leftname)
-                                    it=mReturnNameVec.erase(it);
+                            const ValueDecl* leftDecl = CallDataflow::getKeyDecl(bo->getLHS());
+                            if(!leftDecl)
+                                continue;
+                            keyVariables.erase(leftDecl);
+                            for(unsigned i = 0; i < returnDeclVec.size();){
+                                if(returnDeclVec[i] == leftDecl){
+                                    returnDeclVec.erase(returnDeclVec.begin() + i);
+                                    mReturnNameVec.erase(mReturnNameVec.begin() + i);
+                                }
                                 else
-                                    ++it;
+                                    i++;
                             }
                             
                             // Deal with the simple dataflow: a=foo(); b=a;
-                            string rightname = getSourceCode(bo->getRHS());
-                            while(rightname.size() > 0 && (rightname[0] == '&' || rightname[0] == '*'))
-                                rightname = rightname.substr(1, string::npos);
-                            for(unsigned i = 0; i < mReturnNameVec.size(); i++){
-                                if(mReturnNameVec[i] == rightname){
+                            const ValueDecl* rightDecl = CallDataflow::getKeyDecl(bo->getRHS());
+                            for(unsigned i = 0; i < returnDeclVec.size(); i++){
+                                if(rightDecl && returnDeclVec[i] == rightDecl){
+                                    string leftname = getSourceCode(bo->getLHS());
+                                    while(leftname.size() > 0 && (leftname[0] == '&' || leftname[0] == '*'))
+                                        leftname = leftname.substr(1, string::npos);
                                     mReturnNameVec.push_back(leftname);
-                                    keyVariables.push_back(leftname);
+                                    returnDeclVec.push_back(leftDecl);
+                                    keyVariables.insert(leftDecl);
                                 }
                             }
                         }
@@ -1183,8 +1387,14 @@ bool FindBranchCallVisitor::VisitFunctionDecl (FunctionDecl* Declaration){
     hasSameLog.clear();
     if(Stmt* function = Declaration->getBody()){
         root = function;
+        mParentMap.reset();
+        mExprNodeCache.clear();
         fatherStmt.clear();
+        mSkipBranchSearch = CallFilter::skipsFunction(function);
+        mUseDataflow = !mSkipBranchSearch && dataflowEngine && findDataflowChecks(Declaration, function);
         travelStmt(function, function);
+        if(mUseDataflow)
+            searchDataflowChecks();
     }
     
     return true;
@@ -1192,7 +1402,27 @@ bool FindBranchCallVisitor::VisitFunctionDecl (FunctionDecl* Declaration){
 
 // Handle the translation unit and visit each function declaration
 void FindBranchCallConsumer::HandleTranslationUnit(ASTContext& Context) {
-    Visitor.TraverseDecl(Context.getTranslationUnitDecl());
+    {
+        RunStats::PhaseTimer timer(RunStats::PHASE_VISIT);
+        Visitor.TraverseDecl(Context.getTranslationUnitDecl());
+    }
+    FindBranchCallAction::setAnalyzed(InFile);
+    
+    // Record the files of this translation unit, the incremental mode re-analyzes
+    // the translation unit when any of them changes
+    CallData callData;
+    SourceManager& SM = Context.getSourceManager();
+    for(SourceManager::fileinfo_iterator it = SM.fileinfo_begin(); it != SM.fileinfo_end(); it++){
+        SmallString<128> fileFullPath(it->first->getName());
+        SM.getFileManager().makeAbsolutePath(fileFullPath);
+        callData.addDependency(fileFullPath.str().str());
+    }
+    
+    // The headers in a shared precompiled header are not in the SourceManager, take
+    // the precompiled header instead, which is rebuilt when any of them changes
+    string pchFile = CI->getPreprocessorOpts().ImplicitPCHInclude;
+    if(!pchFile.empty())
+        callData.addDependency(pchFile);
     return;
 }
 
@@ -1202,14 +1432,32 @@ void FindBranchCallConsumer::HandleTranslationUnit(ASTContext& Context) {
 // our statistics. More detials see:
 // http://eli.thegreenplace.net/2014/05/21/compilation-databases-for-clang-based-tools
 map<string, bool> FindBranchCallAction::hasAnalyzed;
+unsigned FindBranchCallAction::analyzedNumber = 0;
 
 // Creat FindFunctionCallConsuer instance and return to ActionFactory
 std::unique_ptr<clang::ASTConsumer> FindBranchCallAction::CreateASTConsumer(CompilerInstance& Compiler, StringRef InFile){
+    // The file is marked after its AST is visited, so a run failing before that,
+    // e.g., rejecting the precompiled header, doesn't stop the file being analyzed again
     if(hasAnalyzed[InFile] == 0){
-        hasAnalyzed[InFile] = 1 ;
         return std::unique_ptr<ASTConsumer>(new FindBranchCallConsumer(&Compiler, InFile));
     }
     else{
         return nullptr;
     }
 }
+
+// Mark the file as analyzed, after its AST is visited
+void FindBranchCallAction::setAnalyzed(StringRef InFile){
+    hasAnalyzed[InFile] = 1;
+    analyzedNumber++;
+}
+
+// Get the number of analyzed files
+unsigned FindBranchCallAction::getAnalyzedNumber(){
+    return analyzedNumber;
+}
+
+// Forget the analyzed files
+void FindBranchCallAction::clearAnalyzed(){
+    hasAnalyzed.clear();
+}
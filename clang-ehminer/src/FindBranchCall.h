@@ -16,14 +16,18 @@
 #define FindBranchCall_h
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <utility>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
+#include <string.h>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/CommandLine.h"
@@ -49,6 +53,7 @@
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendAction.h"
+#include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Parse/ParseAST.h"
 #include "clang/Rewrite/Core/Rewriter.h"
@@ -83,30 +88,107 @@ public:
     
     // Trave the statement and find post-brance call
     void travelStmt(Stmt* stmt, Stmt* father);
+    
+    // Set whether to take the original spelling as the source code of a stmt
+    static void setRawSourceText(bool enable);
+    
+    // Set whether to find the checks of call results by the dataflow engine
+    static void setDataflowEngine(bool enable);
+    
+    // Set whether to record the call statistics, i.e., function_call, call_graph and call_statistic
+    static void setCallStatistic(bool enable);
 
 private:
+#ifdef EHMINER_BENCH
+    // The micro-benchmarks call the private hot paths directly, only in ehminer-bench
+    friend class EhminerBench;
+#endif
+    
     // root stmt, used for ParentMap
     Stmt* root;
     
+    // ParentMap of the function body, built at the first lookup in each function
+    std::unique_ptr<ParentMap> mParentMap;
+    
+    // Get the ParentMap of current function
+    ParentMap& getParentMap();
+    
     // Record branch information
     void recordBranchCall(CallExpr *callExpr, CallExpr *logExpr, ReturnStmt *retStmt, Stmt* otherStmt);
     
     // Search sub-condition in if-statement
     // for if(a||b&&c), get if(a) if(b) if(c)
     vector<Expr*> getSubCondition(Expr* expr);
+    // The key variables of a call, identified by their declarations, e.g., the VarDecl
+    // of ret and err for 'ret = foo(&err)', or the FieldDecl of x for 's->x = foo()'
+    typedef llvm::SmallPtrSet<const ValueDecl*, 8> KeyDeclSet;
+    // Get the key variables used in given stmt
+    void getUsedKeyDecls(const Stmt* stmt, const KeyDeclSet& keyVariables, KeyDeclSet& used);
     // Search check candidate, we only care about if and switch
     // input: branch statement, callexpr (if any), key variables (if any), deep of check condition
-    void searchCheck(Stmt* stmt, CallExpr* callExpr, vector<string> keyVariables, int deep);
+    void searchCheck(Stmt* stmt, CallExpr* callExpr, const KeyDeclSet& keyVariables, int deep);
     // Search pre-branch call site in given stmt
     CallExpr* searchPreBranchCall(Stmt* stmt);
-    // Search post-branch call site in given stmt
-    void searchPostBranchCall(Stmt* stmt, CallExpr* callExpr, string keyword, int deep);
+    // Search post-branch call site in given stmt, keyVariables are the ones checked by the branch
+    void searchPostBranchCall(Stmt* stmt, CallExpr* callExpr, const KeyDeclSet& keyVariables, int deep);
+    
+    // Find the checks of call results in the function body by the dataflow engine,
+    // return false if the CFG can't be built
+    bool findDataflowChecks(FunctionDecl* functionDecl, Stmt* body);
+    // Search post-branch call sites of the checks found by the dataflow engine
+    void searchDataflowChecks();
+    // Search post-branch call sites of a check on the result of callExpr, if stmt is one
+    void searchDataflowCheck(Stmt* stmt, CallExpr* callExpr, int deep);
+    
+    // Find the checks of call results by a dataflow analysis on the CFG, instead of
+    // searching the sibling stmts for the variable names
+    static bool dataflowEngine;
+    
+    // Whether current function is analyzed by the dataflow engine
+    bool mUseDataflow = false;
+    
+    // Whether current function calls no target function, so only the call statistics are recorded
+    bool mSkipBranchSearch = false;
+    
+    // A check depending on a call, conds are the sub-conditions using the result
+    struct DataflowCheck{
+        CallExpr* callExpr;
+        vector<Expr*> conds;
+        vector<string> returnNames;
+    };
+    
+    // The checks of each if and switch stmt in current function
+    llvm::DenseMap<Stmt*, vector<DataflowCheck>> mDataflowChecks;
+    // The if and switch stmts with checks, in the order of CFG blocks
+    vector<Stmt*> mDataflowCheckOrder;
+    
+    // Get the absolute path of a file name, cached per file
+    const string& getAbsolutePath(const char* fileName);
+    // Get the "path:line:column" of a location, the path is absolute
+    string getLocFullPath(FullSourceLoc loc);
+    // Get the absolute path of the file containing a location
+    string getFileFullPath(FullSourceLoc loc);
+    
+    // The absolute paths of the files in this translation unit, indexed by the presumed file name
+    llvm::DenseMap<const char*, string> mAbsolutePathCache;
     
     // Get the source code of given stmt
     string getSourceCode(Stmt* stmt);
     
-    // Get the expr node vector from branch condition
-    vector<string> getExprNodeVec(Expr* expr);
+    // Take the original spelling from the file buffer instead of pretty-printing the AST
+    static bool rawSourceText;
+    
+    // Whether to record the call statistics, the second pass of a two-pass extraction has them
+    static bool callStatistic;
+    
+    // Get the expr node vector from branch condition, and append it to ret
+    void getExprNodeVec(Expr* expr, vector<string>& ret);
+    
+    // Append the expr node vector of a branch condition to ret, memoized per function
+    void appendExprNodeVec(Expr* expr, vector<string>& ret);
+    
+    // The encoded expr node vectors of the branch conditions in current function
+    llvm::DenseMap<Expr*, vector<string>> mExprNodeCache;
     
     
     // Check whether the the function call has been recorded or not
@@ -135,19 +217,29 @@ private:
 
 class FindBranchCallConsumer : public ASTConsumer {
 public:
-    explicit FindBranchCallConsumer(CompilerInstance* CI, StringRef InFile) : Visitor(CI, InFile){}
+    explicit FindBranchCallConsumer(CompilerInstance* CI, StringRef InFile) : Visitor(CI, InFile), CI(CI), InFile(InFile){}
     
     // Handle the translation unit and visit each function declaration
     virtual void HandleTranslationUnit (clang::ASTContext &Context);
     
 private:
     FindBranchCallVisitor Visitor;
+    CompilerInstance* CI;
     StringRef InFile;
 };
 
 class FindBranchCallAction : public ASTFrontendAction {
 public:
     virtual std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler, StringRef InFile);
+    
+    // Mark the file as analyzed, after its AST is visited
+    static void setAnalyzed(StringRef InFile);
+    
+    // Get the number of analyzed files, which tells whether a run reaches the AST
+    static unsigned getAnalyzedNumber();
+    
+    // Forget the analyzed files, so the server can analyze a changed file again
+    static void clearAnalyzed();
 private:
     // If the tool finds more than one entry in json file for a file, it just runs multiple times,
     // once per entry. As far as the tool is concerned, two compilations of the same file can be
@@ -155,6 +247,7 @@ private:
     // statistics. More detials see:
     // http://eli.thegreenplace.net/2014/05/21/compilation-databases-for-clang-based-tools
     static map<string, bool> hasAnalyzed;
+    static unsigned analyzedNumber;
 };
 
 #endif /* FindBranchCall_h */
@@ -13,6 +13,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Option/OptTable.h"
 #include "clang/Tooling/Tooling.h"
 #include "clang/Tooling/CommonOptionsParser.h"
@@ -20,15 +23,29 @@
 
 #include "FindBranchCall.h"
 #include "DataUtility.h"
+#include "PreambleCache.h"
+#include "CallFilter.h"
+#include "RunStats.h"
+#include "SourceList.h"
 
 #include <libconfig.h>
 #include <sqlite3.h>
 
 #include <vector>
+#include <map>
+#include <set>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <cstdlib>
+#include <cerrno>
+#include <csignal>
 #include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 
 #define MAX_DOMAIN 100
@@ -64,6 +81,8 @@ static cl::extrahelp MoreHelp(
                               "-config-file <config-file> specify the config file containing domains and projects.\n"
                               "\tConfig the domains, and projects for each domain we want to analyze. \n"
                               "\tThe default file is in path/to/clang/tools/clang-ehminer/etc/test.conf.\n"
+                              "\tThe optional include_functions and exclude_functions lists decide the\n"
+                              "\tfunctions whose calls are recorded, e.g., to exclude infallible functions.\n"
                               "\n"
                               "-source-file <source-file> specify the file containing paths of all source files.\n"
                               "\tIf there are thousands of files to analyze, xargs will split the files,\n"
@@ -73,6 +92,12 @@ static cl::extrahelp MoreHelp(
                               "\t  find path/in/subtree -name '*.cpp' > all_files.in\n"
                               "\t  clang-ehminer -p build/path -source-file=all_files.in empty.c\n"
                               "\n"
+                              "\tThe file is read while the analysis is running, so the analysis can start\n"
+                              "\tbefore the list is complete. Use \"-\" to read the list from stdin, and\n"
+                              "\t-source-file-null if the names are separated by NUL, e.g.,\n"
+                              "\n"
+                              "\t  find path/in/subtree -name '*.cpp' -print0 | clang-ehminer -p build/path -source-file=- -source-file-null empty.c\n"
+                              "\n"
                               "\tIf there are multiple compile_commands.json files to be merged, use:\n"
                               "\n"
                               "\t  find . -name \"compile_commands.json\" | xargs jq 'flatten' -s > ./compile_commands.json\n"
@@ -99,6 +124,125 @@ static cl::extrahelp MoreHelp(
                               "\t  find path/in/subtree/subdir1 -name '*.cpp'| xargs clang-ehminer -p build/path -database-file=/absolute/path/to/database.db\n"
                               "\t  find path/in/subtree/subdir2 -name '*.cpp'| xargs clang-ehminer -p build/path -database-file=/absolute/path/to/database.db\n"
                               "\n"
+                              "-raw-source-text\n"
+                              "\tStore the code of calls, arguments and conditions as it is spelled in\n"
+                              "\tthe source file, which is much faster than pretty-printing the AST.\n"
+                              "\tCode inside macro expansions is still pretty-printed. Note that the\n"
+                              "\tspelling keeps the original spaces and comments.\n"
+                              "\n"
+                              "-dataflow-engine\n"
+                              "\tFind the checks of a call result by a dataflow analysis on the CFG of\n"
+                              "\teach function, instead of searching the following statements for the\n"
+                              "\tname of the variable. The variables are matched by declaration, so a\n"
+                              "\tshadowing variable is never taken, and the checks nested in unrelated\n"
+                              "\tbranches are also found. A nested check on the same call is recorded\n"
+                              "\twith the conditions of the outer checks, like the name search does.\n"
+                              "\n"
+                              "-target-functions=<file> specify the functions whose calls are checked.\n"
+                              "\tOnly the calls of these functions are recorded in branch_call, and a\n"
+                              "\tfunction calling none of them only records the call statistics, which\n"
+                              "\tskips the search of checks. The file has one name per line, or is a CSV\n"
+                              "\tfile with a CallName column, e.g., py/glibc_return.csv.\n"
+                              "\n"
+                              "-prefilter\n"
+                              "\tWith -target-functions or -min-project, raw-lex each source file before\n"
+                              "\tparsing it, and if none of the target functions is named in it, only\n"
+                              "\trecord its call statistics and call graph, without searching any of its\n"
+                              "\tfunctions for target calls. Note that a call hidden in a macro defined in\n"
+                              "\ta header is not seen, so its checks are not recorded.\n"
+                              "\n"
+                              "-census\n"
+                              "\tThe first pass of a two-pass extraction, only record the call statistics,\n"
+                              "\ti.e., function_call, call_graph and call_statistic, and skip the search of\n"
+                              "\tchecks, which is most of the analysis time.\n"
+                              "\n"
+                              "-min-project <number>\n"
+                              "\tThe second pass of a two-pass extraction, on the database of the census\n"
+                              "\tpass. Only the calls of the functions called in at least <number> projects\n"
+                              "\tare searched for checks, the same threshold as ehminer.py -m, and the call\n"
+                              "\tstatistics are not recorded again. Both passes analyze the same files, and\n"
+                              "\tneither runs in incremental mode, e.g.,\n"
+                              "\t  clang-ehminer -p build/path -find-branch-call -database-file=/absolute/path/to/database.db -source-file=all_files.in -census empty.c\n"
+                              "\t  clang-ehminer -p build/path -find-branch-call -database-file=/absolute/path/to/database.db -source-file=all_files.in -min-project=2 empty.c\n"
+                              "\n"
+                              "-call-graph-index <file>\n"
+                              "\tAt the end of the run, write the edges of call_graph to a compact call\n"
+                              "\tgraph file in compressed sparse row form, which is mapped to memory and\n"
+                              "\tqueried by the CallGraphIndex class for reachability and depth-bounded\n"
+                              "\ttraversals, instead of one SQL query per function.\n"
+                              "\tWith -path-table, the definition locations in the file have the paths\n"
+                              "\tof table file_path instead of their IDs.\n"
+                              "\n"
+                              "-action-summary\n"
+                              "\tAt the end of the run, summarize the actions of the functions, e.g.,\n"
+                              "\texit, output and free, bottom-up over the call graph, and store the\n"
+                              "\taction bitmask and the level of each action in table function_summary.\n"
+                              "\tThis replaces the call graph walks of get_function_action in ehminer.py.\n"
+                              "\n"
+                              "-transaction-size <number> specify the number of rows in one transaction.\n"
+                              "\tThe rows are written by prepared statements and committed in batch.\n"
+                              "\tA larger number makes ingestion faster, and 0 commits every row.\n"
+                              "\n"
+                              "-bulk-load\n"
+                              "\tDrop the indexes of the database when opening it, and build them\n"
+                              "\tafter all source files are analyzed. The counters in call_statistic\n"
+                              "\tare also written once at the end. Use it for a large initial load.\n"
+                              "\n"
+                              "-path-table\n"
+                              "\tStore each file path once in table file_path, and write its ID instead\n"
+                              "\tof the path in the location columns, e.g., \"12:30:5\" for a call at\n"
+                              "\tline 30 and column 5 of the file numbered 12.\n"
+                              "\n"
+                              "-pch-dir=<directory>\n"
+                              "\tGroup the source files by their compile commands, and precompile the\n"
+                              "\t#include lines shared at the beginning of the files in each group into\n"
+                              "\ta header in the directory. Each file is then parsed with the precompiled\n"
+                              "\theader of its group, and falls back to a normal parse if it is rejected.\n"
+                              "\tA quoted header is shared only if it has an include guard.\n"
+                              "\n"
+                              "-incremental\n"
+                              "\tRecord a hash of each source file, the headers it includes and its\n"
+                              "\tcompile command in table tu_cache. When running again on the same\n"
+                              "\tdatabase, unchanged source files are skipped, and the rows of changed\n"
+                              "\tsource files are replaced in one transaction. Note that the rows of\n"
+                              "\tsource files no longer listed are kept.\n"
+                              "\n"
+                              "-j <number> specify the number of worker processes.\n"
+                              "\tEach worker analyzes one source file at a time and sends its rows back\n"
+                              "\tto the main process, which writes them to the database in the order of\n"
+                              "\tthe source files, so the database is the same as a serial run, e.g.,\n"
+                              "\n"
+                              "\t  clang-ehminer -p build/path -j 64 -find-branch-call -database-file=/absolute/path/to/database.db -source-file=all_files.in empty.c\n"
+                              "\n"
+                              "-ehminer-stats=<file>\n"
+                              "\tProfile the wall time and CPU time of each source file, split into parse,\n"
+                              "\tAST visit, getSourceCode, getExprNodeVec and SQLite write, and count the\n"
+                              "\trows emitted to each table. At exit, the profile and the peak RSS are\n"
+                              "\twritten to the file as JSON (\"-\" for stdout), and the slowest files are\n"
+                              "\tprinted to stderr. The time of a phase excludes the phases nested in it,\n"
+                              "\tand parse also takes the rest of the tool run.\n"
+                              "\n"
+                              "-ehminer-stats-top=<number> specify the number of slowest files printed.\n"
+                              "\n"
+                              "-server=<socket> run as a daemon listening on the UNIX socket.\n"
+                              "\tThe compile database, config file and database are loaded once, and the\n"
+                              "\tfile system caches are kept warm between requests, so re-analyzing a\n"
+                              "\tsingle file takes one parse. The server runs in -incremental mode, and\n"
+                              "\tanalyzes the files one by one. Each request is a line:\n"
+                              "\n"
+                              "\t  FILE <source-file>     analyze a source file\n"
+                              "\t  LIST <list-file>       analyze the source files listed in a file\n"
+                              "\t  SHUTDOWN               stop the server\n"
+                              "\n"
+                              "\tThe server answers a line per source file, i.e., \"OK <ms> <file>\",\n"
+                              "\t\"SKIP <ms> <file>\" if unchanged or \"FAIL <ms> <file>\", and then\n"
+                              "\t\"DONE <ok> <skip> <fail>\" for the request, e.g.,\n"
+                              "\n"
+                              "\t  clang-ehminer -p build/path -find-branch-call -database-file=/absolute/path/to/database.db -server=/tmp/ehminer.sock empty.c &\n"
+                              "\t  echo \"FILE path/to/file.c\" | nc -U /tmp/ehminer.sock\n"
+                              "\n"
+                              "\tNote that the compile database is not reloaded when it changes.\n"
+                              "\n"
                               );
 
 // Deal with command line options
@@ -122,6 +266,103 @@ static cl::opt<string> SourceFile("source-file",
                                     cl::desc("Specify source file (default is path/to/clang/tools/clang-ehminer/etc/test.conf."),
                                     cl::cat(ClangMytoolCategory));
 
+static cl::opt<bool> SourceFileNull("source-file-null",
+                                    cl::desc("The names in the source file are separated by NUL, e.g., by find -print0."),
+                                    cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> RawSourceText("raw-source-text",
+                                   cl::desc("Take the original spelling of statements instead of pretty-printing them."),
+                                   cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> DataflowEngine("dataflow-engine",
+                                    cl::desc("Find the checks of call results by a dataflow analysis."),
+                                    cl::cat(ClangMytoolCategory));
+
+static cl::opt<string> TargetFunctions("target-functions",
+                                       cl::desc("Specify the file of the functions whose calls are checked."),
+                                       cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> Prefilter("prefilter",
+                               cl::desc("Only record the call statistics of the source files naming no target function, by raw-lexing them."),
+                               cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> Census("census",
+                            cl::desc("Only record the call statistics, the first pass of a two-pass extraction."),
+                            cl::cat(ClangMytoolCategory));
+
+static cl::opt<unsigned> MinProject("min-project",
+                                    cl::desc("Only search the checks of the functions called in this many projects by the census pass."),
+                                    cl::init(0),
+                                    cl::cat(ClangMytoolCategory));
+
+static cl::opt<string> CallGraphIndexFile("call-graph-index",
+                                          cl::desc("Specify the call graph file in compressed sparse row form written at the end."),
+                                          cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> SummarizeActions("action-summary",
+                                      cl::desc("Summarize the actions of the functions in table function_summary at the end."),
+                                      cl::cat(ClangMytoolCategory));
+
+static cl::opt<unsigned> TransactionSize("transaction-size",
+                                         cl::desc("Specify the number of rows written in one transaction (default is 10000, 0 means autocommit)."),
+                                         cl::init(10000),
+                                         cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> BulkLoad("bulk-load",
+                              cl::desc("Build the database indexes after ingestion."),
+                              cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> PathTable("path-table",
+                              cl::desc("Refer to the file paths by ID in table file_path."),
+                              cl::cat(ClangMytoolCategory));
+
+static cl::opt<string> PCHDir("pch-dir",
+                              cl::desc("Specify the directory of precompiled headers shared by source files."),
+                              cl::cat(ClangMytoolCategory));
+
+static cl::opt<bool> Incremental("incremental",
+                              cl::desc("Skip the unchanged source files, and replace the rows of changed ones."),
+                              cl::cat(ClangMytoolCategory));
+
+static cl::opt<unsigned> Jobs("j",
+                              cl::desc("Specify the number of worker processes (default is 1)."),
+                              cl::init(1),
+                              cl::cat(ClangMytoolCategory));
+
+static cl::opt<string> EhminerStats("ehminer-stats",
+                                    cl::desc("Specify the JSON file of the per-phase profile."),
+                                    cl::cat(ClangMytoolCategory));
+
+static cl::opt<unsigned> EhminerStatsTop("ehminer-stats-top",
+                                         cl::desc("Specify the number of slowest files printed by -ehminer-stats (default is 10)."),
+                                         cl::init(10),
+                                         cl::cat(ClangMytoolCategory));
+
+static cl::opt<string> ServerSocket("server",
+                                    cl::desc("Run as a daemon listening on the UNIX socket."),
+                                    cl::cat(ClangMytoolCategory));
+
+// Read an optional list of function names in the config file, e.g., exclude_functions
+int readFunctionList(config_t* conf, const char* list_name, void (*addFunction)(StringRef)){
+    
+    config_setting_t* list_setting;
+    list_setting = config_lookup(conf, list_name);
+    if(list_setting == NULL)
+        return EXIT_SUCCESS;
+    
+    unsigned list_length;
+    list_length = config_setting_length(list_setting);
+    for(unsigned i = 0; i < list_length; i++){
+        const char* function_name = config_setting_get_string_elem(list_setting, i);
+        if(function_name == NULL){
+            errs()<<"Fail to read function name in "<<list_name<<"!\n";
+            return EXIT_FAILURE;
+        }
+        addFunction(function_name);
+    }
+    return EXIT_SUCCESS;
+}
+
 // Read and parse config file, and then store the domain and project information to ConfigData class
 int initConfig(string config_file){
     
@@ -223,18 +464,607 @@ int initConfig(string config_file){
         }
     }
     
+    // Read the functions whose calls are recorded, or not, e.g., the infallible functions
+    if(readFunctionList(&conf, "include_functions", CallFilter::addInclude) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if(readFunctionList(&conf, "exclude_functions", CallFilter::addExclude) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    
     // Free libconfig object and exit success
     config_destroy(&conf);
     return EXIT_SUCCESS;
 }
 
+// Get the progress "[index/total]", the total is "?" while the source list is being read
+string getProgress(unsigned index, unsigned total){
+    char progress[32];
+    if(total)
+        sprintf(progress, "[%u/%u]", index + 1, total);
+    else
+        sprintf(progress, "[%u/?]", index + 1);
+    return progress;
+}
+
+// Print monitoring information
+void printProgress(unsigned index, unsigned total, string file){
+    time_t now_time = time(NULL);
+    struct tm* current_time = localtime(&now_time);
+    llvm::errs()<<current_time->tm_hour<<":"<<current_time->tm_min<<":"<<current_time->tm_sec<<" ";
+    llvm::errs()<<getProgress(index, total)<<" Find call information in "<<file<<"\n";
+}
+
+// Get the absolute path of a source file
+string getAbsolutePath(string file){
+    SmallString<128> absolutePath(file);
+    llvm::sys::fs::make_absolute(absolutePath);
+    return absolutePath.str().str();
+}
+
+// Run the prefilter on a source file, no function of the file is searched for
+// checks if it names no target function, but its call statistics are recorded
+void prefilterFile(string file){
+    bool skip = Prefilter && !CallFilter::fileHasTarget(getAbsolutePath(file));
+    if(skip)
+        llvm::errs()<<"Only count the calls in file without target functions: "<<file<<"\n";
+    CallFilter::setFileSkipped(skip);
+}
+
+// Run FindBranchCallAction on one source file, return true if the AST is visited
+bool analyzeSourceFile(const CompilationDatabase& compilations, string file){
+    
+    prefilterFile(file);
+    
+    unsigned analyzedNumber = FindBranchCallAction::getAnalyzedNumber();
+    
+    vector<string> mysource;
+    mysource.push_back(file);
+    
+    // Parse with the precompiled header of the file, if any
+    PreambleCache preambleCache;
+    string pchFile = preambleCache.getPreamble(getAbsolutePath(file));
+    if(!pchFile.empty()){
+        ClangTool Tool(compilations, mysource);
+        std::unique_ptr<FrontendActionFactory> FrontendFactory = newFrontendActionFactory<FindBranchCallAction>();
+        Tool.setDiagnosticConsumer(new IgnoringDiagConsumer());
+        CommandLineArguments includePCH;
+        includePCH.push_back("-include-pch");
+        includePCH.push_back(pchFile);
+        Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(includePCH, ArgumentInsertPosition::BEGIN));
+        Tool.run(FrontendFactory.get());
+        
+        // The AST is visited, otherwise the precompiled header is rejected, parse without it
+        if(FindBranchCallAction::getAnalyzedNumber() != analyzedNumber)
+            return true;
+    }
+    
+    ClangTool Tool(compilations, mysource);
+    std::unique_ptr<FrontendActionFactory> FrontendFactory = newFrontendActionFactory<FindBranchCallAction>();
+    Tool.setDiagnosticConsumer(new IgnoringDiagConsumer());
+    Tool.run(FrontendFactory.get());
+    return FindBranchCallAction::getAnalyzedNumber() != analyzedNumber;
+}
+
+// The hash of each file in this run, so that a header is read once
+static map<string, string> fileHashCache;
+
+// The modification time and size of each hashed file when it was read, the server
+// checks them to drop the hashes of the changed files
+static map<string, pair<sys::TimePoint<>, uint64_t>> fileStampCache;
+
+// Get the modification time and size of a file, zero if the file can't be found
+pair<sys::TimePoint<>, uint64_t> getFileStamp(string file){
+    sys::fs::file_status status;
+    if(sys::fs::status(file, status))
+        return make_pair(sys::TimePoint<>(), 0);
+    return make_pair(status.getLastModificationTime(), status.getSize());
+}
+
+// Get the MD5 of the file content, an empty string if the file can't be read
+string hashFile(string file){
+    map<string, string>::iterator it = fileHashCache.find(file);
+    if(it != fileHashCache.end())
+        return it->second;
+    
+    // Take the stamp before reading, so a change during the reading is found next time
+    fileStampCache[file] = getFileStamp(file);
+    
+    string hash;
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(file);
+    if(buffer){
+        MD5 hasher;
+        hasher.update((*buffer)->getBuffer());
+        MD5::MD5Result result;
+        hasher.final(result);
+        SmallString<32> resultStr;
+        MD5::stringifyResult(result, resultStr);
+        hash = resultStr.str().str();
+    }
+    fileHashCache[file] = hash;
+    return hash;
+}
+
+// Hash a translation unit by its compile commands, and the contents of the files it depends on
+string hashTranslationUnit(const CompilationDatabase& compilations, string file, const vector<string>& deps){
+    MD5 hasher;
+    
+    vector<CompileCommand> commands = compilations.getCompileCommands(file);
+    for(unsigned i = 0; i < commands.size(); i++){
+        hasher.update(commands[i].Directory);
+        hasher.update(StringRef("", 1));
+        for(unsigned j = 0; j < commands[i].CommandLine.size(); j++){
+            hasher.update(commands[i].CommandLine[j]);
+            hasher.update(StringRef("", 1));
+        }
+    }
+    
+    hasher.update(hashFile(file));
+    for(unsigned i = 0; i < deps.size(); i++){
+        hasher.update(deps[i]);
+        hasher.update(StringRef("", 1));
+        hasher.update(hashFile(deps[i]));
+    }
+    
+    MD5::MD5Result result;
+    hasher.final(result);
+    SmallString<32> resultStr;
+    MD5::stringifyResult(result, resultStr);
+    return resultStr.str().str();
+}
+
+// Check whether a source file and its dependencies are unchanged since the last analysis
+bool isUnchanged(const CompilationDatabase& compilations, string file){
+    CallData callData;
+    string hash;
+    vector<string> deps;
+    if(!callData.getTranslationUnit(file, hash, deps))
+        return false;
+    return hashTranslationUnit(compilations, file, deps) == hash;
+}
+
+// Analyze the source files one by one in this process
+void analyzeSerial(const CompilationDatabase& compilations, SourceList& source){
+    
+    CallData callData;
+    
+    // We analyze the source files one by one, since something weird happens when analyzing all files at once.
+    // More details see http://lists.llvm.org/pipermail/cfe-dev/2015-April/042654.html
+    string file;
+    for(unsigned i = 0; source.get(i, file); i++){
+        
+        if (access(file.c_str(), F_OK)){
+            llvm::errs()<<"File doesn't exist: "<<file<<"\n";
+            continue;
+        }
+        
+        // Skip the file if nothing changed, otherwise replace its rows
+        string absolutePath = getAbsolutePath(file);
+        if(Incremental && isUnchanged(compilations, absolutePath)){
+            llvm::errs()<<getProgress(i, source.getTotal())<<" Skip unchanged file "<<file<<"\n";
+            continue;
+        }
+        
+        printProgress(i, source.getTotal(), file);
+        RunStats::beginFile(absolutePath);
+        if(Incremental)
+            callData.beginTranslationUnit(absolutePath);
+        bool analyzed = analyzeSourceFile(compilations, file);
+        
+        // A failed file is recorded without hash, so it is analyzed again by the next run
+        if(Incremental)
+            callData.endTranslationUnit(absolutePath, analyzed ? hashTranslationUnit(compilations, absolutePath, callData.getDependencies()) : "");
+        callData.flushCounters();
+        RunStats::endFile();
+    }
+}
+
+// The exit status of a worker which visited no AST, e.g., the file doesn't compile
+#define WORKER_NOT_ANALYZED 2
+
+// Analyze the source files by a pool of worker processes
+// We use processes rather than threads, since ClangTool changes the working directory
+// of the whole process to the directory of each compile command. Each worker analyzes
+// one file and journals its rows, then the main process replays the journals in the
+// order of source files, so the database is exactly the same as a serial run.
+void analyzeParallel(const CompilationDatabase& compilations, SourceList& source){
+    
+    CallData callData;
+    
+    // Running workers, pid -> (index of source file, journal file)
+    map<pid_t, pair<unsigned, string>> running;
+    // Finished files waiting to be replayed, index of source file -> journal file
+    map<unsigned, string> finished;
+    // Finished files whose AST was not visited, they are recorded without hash
+    set<unsigned> failed;
+    // A file listed twice is analyzed only once, like FindBranchCallAction::hasAnalyzed
+    set<string> dispatched;
+    
+    unsigned next = 0;
+    unsigned replayed = 0;
+    string file;
+    while(true){
+        
+        // Start workers until the pool is full, the names are read as needed
+        while(running.size() < Jobs && source.get(next, file)){
+            unsigned i = next++;
+            
+            string absolutePath = getAbsolutePath(file);
+            if (access(file.c_str(), F_OK)){
+                llvm::errs()<<"File doesn't exist: "<<file<<"\n";
+                finished[i] = "";
+                continue;
+            }
+            if(!dispatched.insert(absolutePath).second){
+                finished[i] = "";
+                continue;
+            }
+            if(Incremental && isUnchanged(compilations, absolutePath)){
+                llvm::errs()<<getProgress(i, source.getTotal())<<" Skip unchanged file "<<file<<"\n";
+                finished[i] = "";
+                continue;
+            }
+            
+            SmallString<128> journalFile;
+            if(llvm::sys::fs::createTemporaryFile("ehminer", "journal", journalFile)){
+                llvm::errs()<<"Fail to create journal file for "<<file<<"\n";
+                finished[i] = "";
+                continue;
+            }
+            
+            printProgress(i, source.getTotal(), file);
+            
+            llvm::errs().flush();
+            pid_t pid = fork();
+            if(pid == 0){
+                // Worker: analyze the file and exit without touching the database
+                bool analyzed = false;
+                if(callData.startJournal(journalFile.str().str())){
+                    RunStats::beginFile(absolutePath);
+                    analyzed = analyzeSourceFile(compilations, file);
+                    RunStats::endFile();
+                    if(RunStats::isEnabled())
+                        callData.addFileStats(RunStats::getLastFile());
+                    callData.stopJournal();
+                }
+                llvm::errs().flush();
+                _exit(analyzed ? 0 : WORKER_NOT_ANALYZED);
+            }
+            if(pid < 0){
+                llvm::errs()<<"Fail to fork worker for "<<file<<"\n";
+                llvm::sys::fs::remove(journalFile);
+                finished[i] = "";
+                continue;
+            }
+            running[pid] = make_pair(i, journalFile.str().str());
+        }
+        
+        // Wait for any worker to finish
+        if(!running.empty()){
+            int status;
+            pid_t pid = waitpid(-1, &status, 0);
+            if(pid < 0){
+                if(errno == EINTR)
+                    continue;
+                
+                // The workers can't be waited for any more, fail their files
+                llvm::errs()<<"Fail to wait for workers: "<<strerror(errno)<<"\n";
+                for(map<pid_t, pair<unsigned, string>>::iterator it = running.begin(); it != running.end(); ++it){
+                    string failedFile;
+                    source.get(it->second.first, failedFile);
+                    llvm::errs()<<"Fail to analyze: "<<failedFile<<"\n";
+                    llvm::sys::fs::remove(it->second.second);
+                    finished[it->second.first] = "";
+                }
+                running.clear();
+                continue;
+            }
+            if(running.find(pid) == running.end())
+                continue;
+            unsigned i = running[pid].first;
+            string journalFile = running[pid].second;
+            running.erase(pid);
+            
+            // A worker which visited no AST leaves a complete journal, but no hash for the file
+            if(WIFEXITED(status) && WEXITSTATUS(status) == WORKER_NOT_ANALYZED)
+                failed.insert(i);
+            // A crashed worker may leave a partial journal, drop it
+            else if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+                string crashedFile;
+                source.get(i, crashedFile);
+                llvm::errs()<<"Worker crashed when analyzing: "<<crashedFile<<"\n";
+                llvm::sys::fs::remove(journalFile);
+                journalFile = "";
+            }
+            finished[i] = journalFile;
+        }
+        
+        // Replay the journals in the order of source files
+        while(finished.find(replayed) != finished.end()){
+            string journalFile = finished[replayed];
+            if(!journalFile.empty()){
+                string replayedFile;
+                source.get(replayed, replayedFile);
+                string absolutePath = getAbsolutePath(replayedFile);
+                // The time of replaying is spent writing the rows
+                RunStats::beginFile(absolutePath, RunStats::PHASE_SQLITE);
+                if(Incremental)
+                    callData.beginTranslationUnit(absolutePath);
+                callData.replayJournal(journalFile);
+                if(Incremental)
+                    callData.endTranslationUnit(absolutePath, failed.count(replayed) ? "" : hashTranslationUnit(compilations, absolutePath, callData.getDependencies()));
+                callData.flushCounters();
+                RunStats::endFile();
+                llvm::sys::fs::remove(journalFile);
+            }
+            finished.erase(replayed);
+            failed.erase(replayed);
+            replayed++;
+        }
+        
+        // Stop when all the files are replayed and the list ends
+        if(running.empty() && replayed == next && !source.get(next, file))
+            break;
+    }
+}
+
+// The FileManagers kept warm by the server, one per compile directory, since a
+// FileManager caches the relative paths by name
+static map<string, IntrusiveRefCntPtr<FileManager>> serverFileManagers;
+
+// The address of this symbol locates the executable, like ClangTool does
+static int StaticSymbol;
+
+// Drop the caches of the files changed since they were read, return the number of changed files
+unsigned refreshServerCaches(){
+    unsigned changed = 0;
+    for(map<string, pair<sys::TimePoint<>, uint64_t>>::iterator it = fileStampCache.begin(); it != fileStampCache.end();){
+        if(getFileStamp(it->first) == it->second){
+            ++it;
+            continue;
+        }
+        fileHashCache.erase(it->first);
+        fileStampCache.erase(it++);
+        changed++;
+    }
+    
+    // The FileManagers keep the size of each file, a changed file would be read by its old size
+    if(changed)
+        serverFileManagers.clear();
+    return changed;
+}
+
+// Run FindBranchCallAction on one source file with the warm FileManager of its compile
+// directory, return true if the AST is visited
+bool analyzeSourceFileWarm(const CompilationDatabase& compilations, string file){
+    
+    prefilterFile(file);
+    
+    vector<CompileCommand> commands = compilations.getCompileCommands(file);
+    if(commands.empty()){
+        llvm::errs()<<"No compile command for "<<file<<"\n";
+        return false;
+    }
+    
+    PreambleCache preambleCache;
+    string pchFile = preambleCache.getPreamble(file);
+    string mainExecutable = sys::fs::getMainExecutable("clang_tool", &StaticSymbol);
+    unsigned analyzedNumber = FindBranchCallAction::getAnalyzedNumber();
+    
+    for(unsigned i = 0; i < commands.size() && FindBranchCallAction::getAnalyzedNumber() == analyzedNumber; i++){
+        
+        // The paths in the command are relative to its directory
+        if(chdir(commands[i].Directory.c_str())){
+            llvm::errs()<<"Fail to change to directory: "<<commands[i].Directory<<"\n";
+            continue;
+        }
+        IntrusiveRefCntPtr<FileManager>& files = serverFileManagers[commands[i].Directory];
+        if(!files){
+            FileSystemOptions fileSystemOptions;
+            fileSystemOptions.WorkingDir = commands[i].Directory;
+            files = new FileManager(fileSystemOptions);
+        }
+        
+        // Adjust the command as ClangTool does
+        CommandLineArguments args = getClangStripOutputAdjuster()(commands[i].CommandLine, commands[i].Filename);
+        args = getClangSyntaxOnlyAdjuster()(args, commands[i].Filename);
+        args = getClangStripDependencyFileAdjuster()(args, commands[i].Filename);
+        if(args.empty())
+            continue;
+        args[0] = mainExecutable;
+        
+        // Parse with the precompiled header of the file, if any, and without it if it is rejected
+        for(int withPCH = !pchFile.empty(); withPCH >= 0; withPCH--){
+            CommandLineArguments runArgs = args;
+            if(withPCH){
+                runArgs.insert(runArgs.begin() + 1, pchFile);
+                runArgs.insert(runArgs.begin() + 1, "-include-pch");
+            }
+            IgnoringDiagConsumer diagConsumer;
+            ToolInvocation invocation(runArgs, new FindBranchCallAction, files.get(), std::make_shared<PCHContainerOperations>());
+            invocation.setDiagnosticConsumer(&diagConsumer);
+            invocation.run();
+            if(FindBranchCallAction::getAnalyzedNumber() != analyzedNumber)
+                break;
+        }
+    }
+    return FindBranchCallAction::getAnalyzedNumber() != analyzedNumber;
+}
+
+// Analyze a source file for a client, and answer "<status> <ms> <file>"
+void serveSourceFile(const CompilationDatabase& compilations, string file, FILE* client, unsigned* counts){
+    
+    CallData callData;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    string status = "FAIL";
+    
+    if(access(file.c_str(), F_OK)){
+        llvm::errs()<<"File doesn't exist: "<<file<<"\n";
+    }
+    else if(isUnchanged(compilations, file)){
+        status = "SKIP";
+    }
+    else{
+        RunStats::beginFile(file);
+        callData.beginTranslationUnit(file);
+        FindBranchCallAction::clearAnalyzed();
+        if(analyzeSourceFileWarm(compilations, file))
+            status = "OK";
+        
+        // A failed file is recorded without hash, so it is analyzed again by the next request
+        string hash = status == "OK" ? hashTranslationUnit(compilations, file, callData.getDependencies()) : "";
+        callData.endTranslationUnit(file, hash);
+        callData.flushCounters();
+        RunStats::endFile();
+    }
+    
+    double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fprintf(client, "%s %.0f %s\n", status.c_str(), time, file.c_str());
+    fflush(client);
+    counts[status == "OK" ? 0 : status == "SKIP" ? 1 : 2]++;
+}
+
+// Serve the requests of a client until it closes the connection, return false on SHUTDOWN
+bool serveClient(const CompilationDatabase& compilations, int clientFD, string serverDir){
+    
+    // Separate streams for reading and writing, since a socket can't seek
+    FILE* input = fdopen(clientFD, "r");
+    FILE* output = fdopen(dup(clientFD), "w");
+    if(!input || !output){
+        if(input)
+            fclose(input);
+        else
+            close(clientFD);
+        if(output)
+            fclose(output);
+        return true;
+    }
+    
+    bool running = true;
+    char* line = NULL;
+    size_t lineSize = 0;
+    ssize_t length;
+    while(running && (length = getline(&line, &lineSize, input)) > 0){
+        string request(line, length);
+        while(!request.empty() && (request.back() == '\n' || request.back() == '\r'))
+            request.pop_back();
+        if(request.empty())
+            continue;
+        
+        string command = request.substr(0, request.find(' '));
+        string argument = request.size() > command.size() ? request.substr(command.size() + 1) : "";
+        
+        // The files of the request, relative to the directory of the server
+        vector<string> files;
+        if(command == "FILE" && !argument.empty()){
+            files.push_back(argument);
+        }
+        else if(command == "LIST" && !argument.empty()){
+            SourceList listFile;
+            if(!listFile.open(argument, '\n')){
+                fprintf(output, "ERROR can't read %s\n", argument.c_str());
+                fflush(output);
+                continue;
+            }
+            files = listFile.readAll();
+        }
+        else if(command == "SHUTDOWN"){
+            fprintf(output, "BYE\n");
+            running = false;
+            break;
+        }
+        else{
+            fprintf(output, "ERROR unknown request: %s\n", request.c_str());
+            fflush(output);
+            continue;
+        }
+        
+        // Drop the caches of the changed files, and analyze the files one by one
+        refreshServerCaches();
+        unsigned counts[3] = {0, 0, 0};
+        for(unsigned i = 0; i < files.size(); i++){
+            string file = getAbsolutePath(files[i]);
+            llvm::errs()<<"["<<i+1<<"/"<<files.size()<<"]"<<" Find call information in "<<file<<"\n";
+            serveSourceFile(compilations, file, output, counts);
+            
+            // The compile commands change the working directory
+            if(chdir(serverDir.c_str()))
+                llvm::errs()<<"Fail to change to directory: "<<serverDir<<"\n";
+        }
+        fprintf(output, "DONE %u %u %u\n", counts[0], counts[1], counts[2]);
+        fflush(output);
+    }
+    
+    free(line);
+    fclose(input);
+    fclose(output);
+    return running;
+}
+
+// Listen on a UNIX socket, and serve the clients one by one until SHUTDOWN
+int runServer(const CompilationDatabase& compilations, string socketPath){
+    
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(address.sun_path)){
+        llvm::errs()<<"The socket path is too long: "<<socketPath<<"\n";
+        return EXIT_FAILURE;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+    
+    // Remove the socket left by a server which didn't shut down, but never
+    // anything else, e.g., a mistyped database file
+    struct stat st;
+    if(lstat(socketPath.c_str(), &st) == 0){
+        if(!S_ISSOCK(st.st_mode)){
+            llvm::errs()<<"The server path exists and is not a socket: "<<socketPath<<"\n";
+            return EXIT_FAILURE;
+        }
+        unlink(socketPath.c_str());
+    }
+    
+    int listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFD < 0){
+        llvm::errs()<<"Fail to create socket: "<<strerror(errno)<<"\n";
+        return EXIT_FAILURE;
+    }
+    
+    if(::bind(listenFD, (struct sockaddr*) &address, sizeof(address)) || listen(listenFD, 16)){
+        llvm::errs()<<"Fail to listen on "<<socketPath<<": "<<strerror(errno)<<"\n";
+        close(listenFD);
+        return EXIT_FAILURE;
+    }
+    
+    // A client closing the connection early shouldn't kill the server
+    signal(SIGPIPE, SIG_IGN);
+    
+    string serverDir = getAbsolutePath(".");
+    llvm::errs()<<"Listening on "<<socketPath<<"\n";
+    
+    bool running = true;
+    while(running){
+        int clientFD = accept(listenFD, NULL, NULL);
+        if(clientFD < 0){
+            if(errno == EINTR)
+                continue;
+            llvm::errs()<<"Fail to accept: "<<strerror(errno)<<"\n";
+            break;
+        }
+        running = serveClient(compilations, clientFD, serverDir);
+    }
+    
+    close(listenFD);
+    unlink(socketPath.c_str());
+    return EXIT_SUCCESS;
+}
+
+
 // Please read from here, have fun :)
 int main(int argc, const char **argv){
     
     // Get command line options and source files
     CommonOptionsParser OptionsParser(argc, argv, ClangMytoolCategory);
     vector<string> source = OptionsParser.getSourcePathList();
-
+    
     // Set default config path
     if(ConfigFile.empty())
         ConfigFile = DEFAULT_CONFIG_FILE;
@@ -250,26 +1080,75 @@ int main(int argc, const char **argv){
     // The tool will analyze those files instead of files from command line.
     // We need to use this option when analyzing tens of thoudsands of files,
     // since thess files may lead to exceed the limitation of commands line lenth.
+    // The list is read while analyzing, so that a pipe from find can be analyzed at once.
+    SourceList sourceList;
     if(!SourceFile.empty()){
-        if(freopen(SourceFile.c_str(), "r", stdin) == NULL)
-            fprintf(stderr,"error redirecting stdin\n");
-        source.clear();
-        char filename[200];
-        while(scanf("%s\n",filename)!=EOF){
-            source.push_back(filename);
-        }
+        if(!sourceList.open(SourceFile, SourceFileNull ? '\0' : '\n'))
+            exit(1);
+    }
+    else
+        sourceList.assign(source);
+    
+    // Profile the run from here
+    RunStats::setEnabled(!EhminerStats.empty());
+    
+    // The server replaces the rows of a re-analyzed file, so it runs in incremental mode
+    if(!ServerSocket.empty())
+        Incremental = true;
+    
+    // The passes of a two-pass extraction write different rows for the same files,
+    // which the incremental mode would take as the rows to replace
+    if(Census && MinProject){
+        errs()<<"-census and -min-project are two passes, please run them one by one!\n";
+        exit(1);
+    }
+    if((Census || MinProject) && Incremental){
+        errs()<<"The two-pass extraction can't run in incremental mode!\n";
+        exit(1);
     }
     
     // Set the database
     if(!DatabaseFile.empty()){
         CallData callData;
+        callData.setBulkLoad(BulkLoad);
+        callData.setPathTable(PathTable);
+        callData.setIncremental(Incremental);
+        if(Incremental && BulkLoad){
+            errs()<<"-bulk-load is ignored in incremental mode.\n";
+            callData.setBulkLoad(false);
+        }
         callData.openDatabase(DatabaseFile);
+        callData.setTransactionSize(TransactionSize);
     }
     else{
         errs()<<"Please specify the database file!\n";
         exit(1);
     }
     
+    // Load the target functions, in the second pass only the common ones of the census
+    if(!TargetFunctions.empty() && !CallFilter::loadTargets(TargetFunctions))
+        exit(1);
+    CallFilter::setCensus(Census);
+    if(MinProject){
+        CallData callData;
+        vector<string> names = callData.getCommonCalls(MinProject);
+        if(names.empty()){
+            errs()<<"No function is called in "<<MinProject<<" projects, please run with -census first!\n";
+            exit(1);
+        }
+        CallFilter::retainTargets(names);
+        if(!CallFilter::hasTargets()){
+            errs()<<"None of the target functions is called in "<<MinProject<<" projects!\n";
+            exit(1);
+        }
+        FindBranchCallVisitor::setCallStatistic(false);
+        errs()<<names.size()<<" functions are called in at least "<<MinProject<<" projects.\n";
+    }
+    if(Prefilter && !CallFilter::hasTargets()){
+        errs()<<"-prefilter is ignored without -target-functions or -min-project.\n";
+        Prefilter = false;
+    }
+    
     // At least one action should be done
     if(!FindBranchCall){
         errs()<<"Please specify the action to do (e.g., -find-branch-call)!\n";
@@ -278,34 +1157,31 @@ int main(int argc, const char **argv){
     
     // Start analyzing
     if(FindBranchCall){
-        // We analyze the source files one by one, since something weird happens when analyzing all files at once.
-        // More details see http://lists.llvm.org/pipermail/cfe-dev/2015-April/042654.html
-        for(unsigned i = 0; i < source.size(); i++){
-            vector<string> mysource;
-            mysource.push_back(source[i]);
-            
-            if (access(source[i].c_str(), F_OK)){
-                llvm::errs()<<"File doesn't exist: "<<source[i]<<"\n";
-                continue;
-            }
-            
-            // Print monitoring information
-            time_t now_time = time(NULL);
-            struct tm* current_time = localtime(&now_time);
-            llvm::errs()<<current_time->tm_hour<<":"<<current_time->tm_min<<":"<<current_time->tm_sec<<" ";
-            llvm::errs()<<"["<<i+1<<"/"<<source.size()<<"]"<<" Find call information in "<<mysource[0]<<"\n";
-            
-            // Run analyzing action
-            ClangTool Tool(OptionsParser.getCompilations(), mysource);
-            std::unique_ptr<FrontendActionFactory> FrontendFactory = newFrontendActionFactory<FindBranchCallAction>();
-            Tool.setDiagnosticConsumer(new IgnoringDiagConsumer());
-            Tool.run(FrontendFactory.get());
+        FindBranchCallVisitor::setRawSourceText(RawSourceText);
+        FindBranchCallVisitor::setDataflowEngine(DataflowEngine);
+        if(!PCHDir.empty()){
+            PreambleCache preambleCache;
+            // The files are grouped before the analysis, so the list is read at once
+            preambleCache.buildPreambles(OptionsParser.getCompilations(), sourceList.readAll(), PCHDir);
         }
+        if(!ServerSocket.empty())
+            rc = runServer(OptionsParser.getCompilations(), ServerSocket);
+        else if(Jobs > 1)
+            analyzeParallel(OptionsParser.getCompilations(), sourceList);
+        else
+            analyzeSerial(OptionsParser.getCompilations(), sourceList);
     }
     
-    // Close database
+    // Close database, after writing the call graph file from it
     CallData callData;
+    if(!CallGraphIndexFile.empty() && !callData.writeCallGraphIndex(CallGraphIndexFile))
+        rc = 1;
+    if(SummarizeActions && !callData.writeActionSummary())
+        rc = 1;
     callData.closeDatabase();
     
-    return 0;
+    // Write the profile
+    RunStats::writeReport(EhminerStats, EhminerStatsTop);
+    
+    return rc;
 }
@@ -0,0 +1,318 @@
+//===-- PreambleCache.cpp - Precompiled headers shared by translation units --===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a cache of precompiled headers shared by source files.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PreambleCache.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Tooling/Tooling.h"
+
+#include <fstream>
+#include <unistd.h>
+
+using namespace clang;
+
+// The members are static, the preambles are built once and used all around our project
+map<string, string> PreambleCache::preambleOfFile;
+
+// Get the absolute path of a file relative to a directory, without "." and ".."
+static string getAbsolutePath(string directory, string file){
+    SmallString<128> path;
+    if(llvm::sys::path::is_absolute(file))
+        path = file;
+    else{
+        path = directory;
+        llvm::sys::path::append(path, file);
+    }
+    llvm::sys::path::remove_dots(path, true);
+    return path.str().str();
+}
+
+// Get the compile arguments without the compiler, the source file, the output
+// file and the dependency file, the same as the adjusters of ClangTool
+static vector<string> getCompileArgs(const CompileCommand& command, string file){
+    vector<string> args;
+    for(unsigned i = 1; i < command.CommandLine.size(); i++){
+        const string& arg = command.CommandLine[i];
+        if(arg == "-o" || arg == "-MF" || arg == "-MT" || arg == "-MQ"){
+            i++;
+            continue;
+        }
+        if(arg == "-c" || arg.compare(0, 2, "-o") == 0 || arg.compare(0, 2, "-M") == 0)
+            continue;
+        if(arg[0] != '-' && getAbsolutePath(command.Directory, arg) == file)
+            continue;
+        args.push_back(arg);
+    }
+    return args;
+}
+
+// Get the language of the header, e.g., c-header for a C source file
+static string getHeaderLanguage(const vector<string>& args, string file){
+    for(unsigned i = 0; i + 1 < args.size(); i++)
+        if(args[i] == "-x")
+            return args[i + 1] + "-header";
+    
+    StringRef extension = llvm::sys::path::extension(file);
+    if(extension == ".c")
+        return "c-header";
+    if(extension == ".m")
+        return "objective-c-header";
+    return "c++-header";
+}
+
+// Read the next line which is not blank, and remove the comments from it,
+// return false at the end of file
+static bool getCodeLine(ifstream& in, string& line){
+    bool inComment = false;
+    string raw;
+    while(getline(in, raw)){
+        string code;
+        size_t i = 0;
+        while(i < raw.size()){
+            if(inComment){
+                size_t end = raw.find("*/", i);
+                if(end == string::npos)
+                    break;
+                inComment = false;
+                i = end + 2;
+            }
+            else if(raw.compare(i, 2, "/*") == 0){
+                inComment = true;
+                code += ' ';
+                i += 2;
+            }
+            else if(raw.compare(i, 2, "//") == 0)
+                break;
+            else
+                code += raw[i++];
+        }
+        
+        size_t begin = code.find_first_not_of(" \t\r\f\v");
+        if(begin == string::npos)
+            continue;
+        size_t end = code.find_last_not_of(" \t\r\f\v");
+        line = code.substr(begin, end - begin + 1);
+        return true;
+    }
+    return false;
+}
+
+// Get the argument of a directive, e.g., "stdio.h>" for "# include <stdio.h>",
+// return false if the line is not the directive
+static bool getDirective(string line, string name, string& argument){
+    if(line.empty() || line[0] != '#')
+        return false;
+    size_t begin = line.find_first_not_of(" \t", 1);
+    if(begin == string::npos || line.compare(begin, name.size(), name) != 0)
+        return false;
+    begin += name.size();
+    if(begin < line.size() && line[begin] != ' ' && line[begin] != '\t' && line[begin] != '<' && line[begin] != '"')
+        return false;
+    begin = line.find_first_not_of(" \t", begin);
+    argument = begin == string::npos ? "" : line.substr(begin);
+    return true;
+}
+
+// Check whether a header starts with an include guard, so that including it again
+// after the precompiled header is skipped
+static bool hasIncludeGuard(string header){
+    ifstream in(header.c_str());
+    string line, macro, define;
+    if(!getCodeLine(in, line))
+        return false;
+    if(getDirective(line, "pragma", macro))
+        return macro == "once";
+    if(!getDirective(line, "ifndef", macro) || macro.empty())
+        return false;
+    if(!getCodeLine(in, line) || !getDirective(line, "define", define))
+        return false;
+    return define.compare(0, macro.size(), macro) == 0 &&
+           (define.size() == macro.size() || define[macro.size()] == ' ' || define[macro.size()] == '\t');
+}
+
+// Get the key of the compile command, the files with the same key share a preamble
+string PreambleCache::getGroupKey(const CompileCommand& command, string file){
+    vector<string> args = getCompileArgs(command, file);
+    string key = command.Directory;
+    key += '\0';
+    for(unsigned i = 0; i < args.size(); i++){
+        key += args[i];
+        key += '\0';
+    }
+    key += getHeaderLanguage(args, file);
+    return key;
+}
+
+// Get the #include lines at the beginning of a source file. The lines are stopped
+// by any other code, and by a quoted header which can't be precompiled, i.e., it is
+// not in the directory of the source file or has no include guard. A quoted header
+// is written by its absolute path, so the lines can be compared between files.
+vector<string> PreambleCache::getLeadingIncludes(string file){
+    vector<string> includes;
+    ifstream in(file.c_str());
+    string line, header;
+    while(getCodeLine(in, line)){
+        if(!getDirective(line, "include", header) || header.size() < 3)
+            break;
+        
+        if(header[0] == '<'){
+            size_t end = header.find('>');
+            if(end == string::npos || end != header.size() - 1)
+                break;
+            includes.push_back("#include " + header);
+        }
+        else if(header[0] == '"'){
+            size_t end = header.find('"', 1);
+            if(end == string::npos || end != header.size() - 1)
+                break;
+            string headerPath = getAbsolutePath(llvm::sys::path::parent_path(file), header.substr(1, end - 1));
+            if(!llvm::sys::fs::exists(headerPath) || !hasIncludeGuard(headerPath))
+                break;
+            includes.push_back("#include \"" + headerPath + "\"");
+        }
+        else
+            break;
+    }
+    return includes;
+}
+
+// Build a precompiled header by the compile command of a source file
+bool PreambleCache::buildPreamble(const CompileCommand& command, string file, string headerFile, string pchFile){
+    
+    vector<string> args = getCompileArgs(command, file);
+    string language = getHeaderLanguage(args, file);
+    
+    // Use the path of this tool as the compiler, so that the builtin headers are found, like ClangTool
+    static int StaticSymbol;
+    args.insert(args.begin(), llvm::sys::fs::getMainExecutable("clang_tool", &StaticSymbol));
+    args.push_back("-x");
+    args.push_back(language);
+    args.push_back(headerFile);
+    args.push_back("-o");
+    args.push_back(pchFile);
+    
+    // Run in the directory of the compile command, like ClangTool
+    SmallString<128> currentDirectory;
+    if(llvm::sys::fs::current_path(currentDirectory) || chdir(command.Directory.c_str()))
+        return false;
+    
+    // The base consumer counts the errors and prints nothing
+    DiagnosticConsumer diagConsumer;
+    IntrusiveRefCntPtr<FileManager> files(new FileManager(FileSystemOptions()));
+    ToolInvocation invocation(args, new GeneratePCHAction, files.get());
+    invocation.setDiagnosticConsumer(&diagConsumer);
+    bool success = invocation.run() && diagConsumer.getNumErrors() == 0;
+    
+    if(chdir(currentDirectory.c_str()))
+        llvm::errs()<<"Fail to return to directory "<<currentDirectory<<"\n";
+    
+    if(!success)
+        llvm::sys::fs::remove(pchFile);
+    return success && llvm::sys::fs::exists(pchFile);
+}
+
+// Build the precompiled headers of the source files in directory pchDir. The files are
+// grouped by their compile commands, and a group of at least two files with some
+// common leading #include lines shares a precompiled header of these lines.
+void PreambleCache::buildPreambles(const CompilationDatabase& compilations, const vector<string>& source, string pchDir){
+    
+    SmallString<128> pchDirPath(pchDir);
+    llvm::sys::fs::make_absolute(pchDirPath);
+    if(llvm::sys::fs::create_directories(pchDirPath)){
+        llvm::errs()<<"Fail to create directory "<<pchDirPath<<"\n";
+        return;
+    }
+    
+    // Group the source files, key -> (files, compile command of the first file)
+    map<string, pair<vector<string>, CompileCommand>> groups;
+    for(unsigned i = 0; i < source.size(); i++){
+        SmallString<128> absolutePath(source[i]);
+        llvm::sys::fs::make_absolute(absolutePath);
+        string file = absolutePath.str().str();
+        if(preambleOfFile.count(file))
+            continue;
+        preambleOfFile[file] = "";
+        
+        // A file with several compile commands is parsed several times, skip it
+        vector<CompileCommand> commands = compilations.getCompileCommands(file);
+        if(commands.size() != 1)
+            continue;
+        
+        pair<vector<string>, CompileCommand>& group = groups[getGroupKey(commands[0], file)];
+        if(group.first.empty())
+            group.second = commands[0];
+        group.first.push_back(file);
+    }
+    
+    for(map<string, pair<vector<string>, CompileCommand>>::iterator it = groups.begin(); it != groups.end(); it++){
+        const vector<string>& files = it->second.first;
+        if(files.size() < 2)
+            continue;
+        
+        // The #include lines shared by all files of the group
+        vector<string> includes = getLeadingIncludes(files[0]);
+        for(unsigned i = 1; i < files.size() && !includes.empty(); i++){
+            vector<string> fileIncludes = getLeadingIncludes(files[i]);
+            unsigned common = 0;
+            while(common < includes.size() && common < fileIncludes.size() && includes[common] == fileIncludes[common])
+                common++;
+            includes.resize(common);
+        }
+        if(includes.empty())
+            continue;
+        
+        // Name the preamble by the hash of the group, so the name is kept between runs
+        llvm::MD5 hasher;
+        hasher.update(it->first);
+        for(unsigned i = 0; i < includes.size(); i++)
+            hasher.update(includes[i]);
+        llvm::MD5::MD5Result result;
+        hasher.final(result);
+        SmallString<32> resultStr;
+        llvm::MD5::stringifyResult(result, resultStr);
+        
+        SmallString<128> headerFile(pchDirPath);
+        llvm::sys::path::append(headerFile, "preamble-" + resultStr.str().str() + ".h");
+        string pchFile = headerFile.str().str() + ".pch";
+        
+        ofstream out(headerFile.c_str());
+        for(unsigned i = 0; i < includes.size(); i++)
+            out<<includes[i]<<"\n";
+        out.close();
+        
+        llvm::errs()<<"Build precompiled header of "<<includes.size()<<" headers for "<<files.size()<<" files: "<<pchFile<<"\n";
+        if(!buildPreamble(it->second.second, files[0], headerFile.str().str(), pchFile)){
+            llvm::errs()<<"Fail to build precompiled header: "<<pchFile<<"\n";
+            continue;
+        }
+        
+        for(unsigned i = 0; i < files.size(); i++)
+            preambleOfFile[files[i]] = pchFile;
+    }
+}
+
+// Get the precompiled header of a source file by its absolute path, empty if none
+string PreambleCache::getPreamble(string file){
+    map<string, string>::iterator it = preambleOfFile.find(file);
+    if(it == preambleOfFile.end())
+        return "";
+    return it->second;
+}
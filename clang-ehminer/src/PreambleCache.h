@@ -0,0 +1,62 @@
+//===- PreambleCache.h - Precompiled headers shared by translation units -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a cache of precompiled headers, each one is shared by
+// the source files with the same compile flags and the same leading includes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef PreambleCache_h
+#define PreambleCache_h
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "clang/Tooling/CompilationDatabase.h"
+
+using namespace std;
+using namespace clang::tooling;
+
+//===----------------------------------------------------------------------===//
+//
+//                     PreambleCache Class
+//
+//===----------------------------------------------------------------------===//
+// Most source files of a project start with the same #include lines, and are
+// compiled with the same flags, so they parse the same headers again and again.
+// We group the source files by their compile flags, and write the #include
+// lines shared by all files of a group into a header, which is precompiled once.
+// Each file of the group is then parsed with -include-pch, and the headers in
+// the PCH are skipped by their include guards when the file includes them.
+//===----------------------------------------------------------------------===//
+class PreambleCache{
+public:
+    // Build the precompiled headers of the source files in directory pchDir
+    void buildPreambles(const CompilationDatabase& compilations, const vector<string>& source, string pchDir);
+    
+    // Get the precompiled header of a source file by its absolute path, empty if none
+    string getPreamble(string file);
+    
+private:
+    // Get the key of the compile command, the files with the same key share a preamble
+    string getGroupKey(const CompileCommand& command, string file);
+    
+    // Get the #include lines at the beginning of a source file
+    vector<string> getLeadingIncludes(string file);
+    
+    // Build a precompiled header by the compile command of a source file
+    bool buildPreamble(const CompileCommand& command, string file, string headerFile, string pchFile);
+    
+    // The precompiled header of each source file
+    static map<string, string> preambleOfFile;
+};
+
+#endif /* PreambleCache_h */
@@ -0,0 +1,243 @@
+//===------ RunStats.cpp - Per-phase profile of the analysis ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the profile of the time spent in each phase of the
+// analysis of each source file, and the rows emitted to each table.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RunStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+// The names of the phases and tables in the report
+static const char* phaseName[RunStats::PHASE_NUM] = {
+    "parse", "visit", "source_code", "expr_node", "sqlite"
+};
+static const char* tableName[RunStats::TABLE_NUM] = {
+    "branch_call", "function_call", "call_graph", "prebranch_call", "postbranch_call"
+};
+
+bool RunStats::enabled = false;
+bool RunStats::inFile = false;
+vector<RunStats::FileStats> RunStats::files;
+vector<RunStats::Phase> RunStats::phaseStack;
+double RunStats::lastWallTime = 0;
+double RunStats::lastCPUTime = 0;
+double RunStats::startWallTime = 0;
+double RunStats::startCPUTime = 0;
+
+// Get the wall time in seconds
+double RunStats::getWallTime(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Get the CPU time of this process in seconds
+double RunStats::getCPUTime(){
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Enable the profile, the run time is counted from here
+void RunStats::setEnabled(bool enable){
+    enabled = enable;
+    startWallTime = getWallTime();
+    startCPUTime = getCPUTime();
+}
+
+// Charge the time since the last charge to the phase on the stack top
+void RunStats::charge(){
+    double wallTime = getWallTime();
+    double cpuTime = getCPUTime();
+    FileStats& fileStats = files.back();
+    fileStats.wallTime[phaseStack.back()] += wallTime - lastWallTime;
+    fileStats.cpuTime[phaseStack.back()] += cpuTime - lastCPUTime;
+    lastWallTime = wallTime;
+    lastCPUTime = cpuTime;
+}
+
+// Begin the profile of a source file
+void RunStats::beginFile(string file, Phase basePhase){
+    if(!enabled)
+        return;
+    if(inFile)
+        endFile();
+    
+    FileStats fileStats;
+    fileStats.file = file;
+    for(unsigned i = 0; i < PHASE_NUM; i++){
+        fileStats.wallTime[i] = 0;
+        fileStats.cpuTime[i] = 0;
+    }
+    for(unsigned i = 0; i < TABLE_NUM; i++)
+        fileStats.rows[i] = 0;
+    files.push_back(fileStats);
+    
+    inFile = true;
+    phaseStack.clear();
+    phaseStack.push_back(basePhase);
+    lastWallTime = getWallTime();
+    lastCPUTime = getCPUTime();
+}
+
+// End the profile of current source file
+void RunStats::endFile(){
+    if(!enabled || !inFile)
+        return;
+    charge();
+    inFile = false;
+    phaseStack.clear();
+}
+
+// Get the profile of the last source file
+const RunStats::FileStats& RunStats::getLastFile(){
+    return files.back();
+}
+
+// Add the profile of current source file from a worker
+void RunStats::mergeFile(const FileStats& fileStats){
+    if(!enabled || !inFile)
+        return;
+    FileStats& current = files.back();
+    for(unsigned i = 0; i < PHASE_NUM; i++){
+        current.wallTime[i] += fileStats.wallTime[i];
+        current.cpuTime[i] += fileStats.cpuTime[i];
+    }
+    for(unsigned i = 0; i < TABLE_NUM; i++)
+        current.rows[i] += fileStats.rows[i];
+}
+
+// Push a phase, return false if the profile is disabled or no file is profiled
+bool RunStats::enterPhase(Phase phase){
+    if(!enabled || !inFile)
+        return false;
+    charge();
+    phaseStack.push_back(phase);
+    return true;
+}
+
+// Pop the phase on the stack top
+void RunStats::leavePhase(){
+    // The file may end inside the phase, e.g., a worker exits
+    if(!inFile || phaseStack.size() <= 1)
+        return;
+    charge();
+    phaseStack.pop_back();
+}
+
+// Count a row emitted to a table
+void RunStats::addRow(Table table){
+    if(enabled && inFile)
+        files.back().rows[table]++;
+}
+
+// Write a string as a JSON string literal
+static void writeJSONString(FILE* file, const string& str){
+    fputc('"', file);
+    for(unsigned i = 0; i < str.size(); i++){
+        unsigned char c = str[i];
+        if(c == '"' || c == '\\')
+            fprintf(file, "\\%c", c);
+        else if(c < 0x20)
+            fprintf(file, "\\u%04x", c);
+        else
+            fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+// Write the time of the phases and the rows of the tables as JSON members
+static void writeJSONProfile(FILE* file, const double* wallTime, const double* cpuTime, const unsigned long long* rows, const char* indent){
+    fprintf(file, "%s\"phases\": {", indent);
+    for(unsigned i = 0; i < RunStats::PHASE_NUM; i++)
+        fprintf(file, "%s\"%s\": {\"wall\": %.6f, \"cpu\": %.6f}", i ? ", " : "", phaseName[i], wallTime[i], cpuTime[i]);
+    fprintf(file, "},\n");
+    fprintf(file, "%s\"rows\": {", indent);
+    for(unsigned i = 0; i < RunStats::TABLE_NUM; i++)
+        fprintf(file, "%s\"%s\": %llu", i ? ", " : "", tableName[i], rows[i]);
+    fprintf(file, "}");
+}
+
+// Write the profile as JSON, and print the slowest topNum source files to stderr
+void RunStats::writeReport(string jsonFile, unsigned topNum){
+    if(!enabled)
+        return;
+    endFile();
+    
+    // Sum up the source files
+    double wallTime[PHASE_NUM] = {0};
+    double cpuTime[PHASE_NUM] = {0};
+    unsigned long long rows[TABLE_NUM] = {0};
+    vector<pair<double, unsigned>> fileTime;
+    for(unsigned i = 0; i < files.size(); i++){
+        double fileWallTime = 0;
+        for(unsigned j = 0; j < PHASE_NUM; j++){
+            wallTime[j] += files[i].wallTime[j];
+            cpuTime[j] += files[i].cpuTime[j];
+            fileWallTime += files[i].wallTime[j];
+        }
+        for(unsigned j = 0; j < TABLE_NUM; j++)
+            rows[j] += files[i].rows[j];
+        fileTime.push_back(make_pair(fileWallTime, i));
+    }
+    
+    // ru_maxrss is in kilobytes on Linux, the children are the -j workers
+    struct rusage selfUsage, childrenUsage;
+    getrusage(RUSAGE_SELF, &selfUsage);
+    getrusage(RUSAGE_CHILDREN, &childrenUsage);
+    
+    FILE* file = jsonFile == "-" ? stdout : fopen(jsonFile.c_str(), "w");
+    if(file == NULL){
+        fprintf(stderr, "Can't open stats file: %s\n", jsonFile.c_str());
+    }
+    else{
+        fprintf(file, "{\n");
+        fprintf(file, "  \"wall_time\": %.6f,\n", getWallTime() - startWallTime);
+        fprintf(file, "  \"cpu_time\": %.6f,\n", getCPUTime() - startCPUTime);
+        fprintf(file, "  \"peak_rss_kb\": %ld,\n", selfUsage.ru_maxrss);
+        fprintf(file, "  \"peak_worker_rss_kb\": %ld,\n", childrenUsage.ru_maxrss);
+        fprintf(file, "  \"file_num\": %zu,\n", files.size());
+        writeJSONProfile(file, wallTime, cpuTime, rows, "  ");
+        fprintf(file, ",\n  \"files\": [");
+        for(unsigned i = 0; i < files.size(); i++){
+            fprintf(file, "%s\n    {\n      \"file\": ", i ? "," : "");
+            writeJSONString(file, files[i].file);
+            fprintf(file, ",\n      \"wall_time\": %.6f,\n", fileTime[i].first);
+            writeJSONProfile(file, files[i].wallTime, files[i].cpuTime, files[i].rows, "      ");
+            fprintf(file, "\n    }");
+        }
+        fprintf(file, "\n  ]\n}\n");
+        if(file != stdout)
+            fclose(file);
+    }
+    
+    // The slowest source files by wall time
+    if(topNum > fileTime.size())
+        topNum = fileTime.size();
+    partial_sort(fileTime.begin(), fileTime.begin() + topNum, fileTime.end(), [](const pair<double, unsigned>& a, const pair<double, unsigned>& b){
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    if(topNum > 0)
+        fprintf(stderr, "The %u slowest files (wall time in seconds):\n", topNum);
+    for(unsigned i = 0; i < topNum; i++){
+        const FileStats& fileStats = files[fileTime[i].second];
+        fprintf(stderr, "%10.3f ", fileTime[i].first);
+        for(unsigned j = 0; j < PHASE_NUM; j++)
+            fprintf(stderr, " %s %.3f", phaseName[j], fileStats.wallTime[j]);
+        fprintf(stderr, "  %s\n", fileStats.file.c_str());
+    }
+}
@@ -0,0 +1,120 @@
+//===- RunStats.h - Per-phase profile of the analysis -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the profile of the time spent in each phase of the
+// analysis of each source file, and the rows emitted to each table.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RunStats_h
+#define RunStats_h
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+//===----------------------------------------------------------------------===//
+//
+//                     RunStats Class
+//
+//===----------------------------------------------------------------------===//
+// The phases of a source file are timed by a stack, the time is charged to the
+// phase on the stack top, so the time of each phase excludes the nested ones,
+// e.g., the visit time excludes getSourceCode, and the phases sum to the total.
+// The base phase of a source file is the parse, which also takes the rest of the
+// tool run. In -j mode, the worker sends its profile to the parent in the
+// journal, and the parent adds the time spent replaying the journal.
+// All members are static so that the profile can be updated all around.
+//===----------------------------------------------------------------------===//
+class RunStats{
+public:
+    enum Phase{
+        PHASE_PARSE,
+        PHASE_VISIT,
+        PHASE_SOURCE_CODE,
+        PHASE_EXPR_NODE,
+        PHASE_SQLITE,
+        PHASE_NUM
+    };
+    
+    enum Table{
+        TABLE_BRANCH_CALL,
+        TABLE_FUNCTION_CALL,
+        TABLE_CALL_GRAPH,
+        TABLE_PREBRANCH_CALL,
+        TABLE_POSTBRANCH_CALL,
+        TABLE_NUM
+    };
+    
+    // The profile of a source file
+    struct FileStats{
+        string file;
+        double wallTime[PHASE_NUM];
+        double cpuTime[PHASE_NUM];
+        unsigned long long rows[TABLE_NUM];
+    };
+    
+    // Time a phase in the scope of the timer, nothing is done if the profile is disabled
+    class PhaseTimer{
+    public:
+        explicit PhaseTimer(Phase phase) : active(enterPhase(phase)){}
+        ~PhaseTimer(){ if(active) leavePhase(); }
+    private:
+        bool active;
+    };
+    
+    // Enable the profile, the run time is counted from here
+    static void setEnabled(bool enable);
+    static bool isEnabled(){ return enabled; }
+    
+    // Begin the profile of a source file, the time is charged to basePhase when no other phase is running
+    static void beginFile(string file, Phase basePhase = PHASE_PARSE);
+    
+    // End the profile of current source file
+    static void endFile();
+    
+    // Get the profile of the last source file
+    static const FileStats& getLastFile();
+    
+    // Add the profile of current source file from a worker
+    static void mergeFile(const FileStats& fileStats);
+    
+    // Count a row emitted to a table
+    static void addRow(Table table);
+    
+    // Write the profile as JSON, and print the slowest topNum source files to stderr
+    static void writeReport(string jsonFile, unsigned topNum);
+
+private:
+    // Push a phase, return false if the profile is disabled or no file is profiled
+    static bool enterPhase(Phase phase);
+    
+    // Pop the phase on the stack top
+    static void leavePhase();
+    
+    // Charge the time since the last charge to the phase on the stack top
+    static void charge();
+    
+    // Get the wall time and the CPU time of this process in seconds
+    static double getWallTime();
+    static double getCPUTime();
+    
+    static bool enabled;
+    static bool inFile;
+    static vector<FileStats> files;
+    static vector<Phase> phaseStack;
+    static double lastWallTime;
+    static double lastCPUTime;
+    static double startWallTime;
+    static double startCPUTime;
+};
+
+#endif /* RunStats_h */
@@ -0,0 +1,98 @@
+//===------ SourceList.cpp - Streaming reader of the source file list ----===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the list of source files to analyze, which is read
+// from a file or a pipe while the analysis is running.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceList.h"
+
+#include <cstdlib>
+
+SourceList::~SourceList(){
+    if(file && file != stdin)
+        fclose(file);
+}
+
+// Read the names from a file, "-" for stdin
+bool SourceList::open(string fileName, char delimiter){
+    
+    if(file && file != stdin)
+        fclose(file);
+    names.clear();
+    
+    file = fileName == "-" ? stdin : fopen(fileName.c_str(), "r");
+    if(file == NULL){
+        fprintf(stderr, "Can't open source file: %s\n", fileName.c_str());
+        complete = true;
+        return false;
+    }
+    this->delimiter = delimiter;
+    complete = false;
+    return true;
+}
+
+// Take the names from the command line
+void SourceList::assign(const vector<string>& names){
+    this->names = names;
+    complete = true;
+}
+
+// Read the next name, the empty names are skipped
+bool SourceList::readName(){
+    
+    if(complete)
+        return false;
+    
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    while((length = getdelim(&line, &size, delimiter, file)) > 0){
+        if(line[length - 1] == delimiter)
+            length--;
+        // The lists written on Windows end lines with "\r\n"
+        if(delimiter == '\n' && length > 0 && line[length - 1] == '\r')
+            length--;
+        if(length > 0){
+            names.push_back(string(line, length));
+            free(line);
+            return true;
+        }
+    }
+    free(line);
+    
+    // The end of the list
+    if(file != stdin)
+        fclose(file);
+    file = NULL;
+    complete = true;
+    return false;
+}
+
+// Get the name numbered index, reading more names if needed
+bool SourceList::get(unsigned index, string& name){
+    while(index >= names.size())
+        if(!readName())
+            return false;
+    name = names[index];
+    return true;
+}
+
+// Read all the names
+const vector<string>& SourceList::readAll(){
+    while(readName());
+    return names;
+}
+
+// Get the number of names, 0 if the list is not completely read
+unsigned SourceList::getTotal(){
+    return complete ? names.size() : 0;
+}
@@ -0,0 +1,70 @@
+//===- SourceList.h - Streaming reader of the source file list -===//
+//
+//   EH-Miner: Mining Error-Handling Bugs without Error Specification Input
+//
+// Author: Zhouyang Jia, PhD Candidate
+// Affiliation: School of Computer Science, National University of Defense Technology
+// Email: jiazhouyang@nudt.edu.cn
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the list of source files to analyze, which is read
+// from a file or a pipe while the analysis is running.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SourceList_h
+#define SourceList_h
+
+#include <cstdio>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+//===----------------------------------------------------------------------===//
+//
+//                     SourceList Class
+//
+//===----------------------------------------------------------------------===//
+// The names are separated by newlines, or by NULs as written by 'find -print0',
+// so a name can have spaces, and has no length limit. The names are read on
+// demand, so the analysis of the first files starts while 'find' is still
+// listing the others, e.g.,
+//
+//      find . -name '*.c' -print0 | clang-ehminer -source-file=- -source-file-null ...
+//
+// The names read are kept, so a name can be got again by its index.
+//===----------------------------------------------------------------------===//
+class SourceList{
+public:
+    SourceList() : file(NULL), delimiter('\n'), complete(true){}
+    ~SourceList();
+    
+    // Read the names from a file, "-" for stdin, return false if it can't be opened
+    bool open(string fileName, char delimiter);
+    
+    // Take the names from the command line
+    void assign(const vector<string>& names);
+    
+    // Get the name numbered index, reading more names if needed, return false
+    // if the list has fewer names
+    bool get(unsigned index, string& name);
+    
+    // Read all the names, e.g., to group the files before the analysis
+    const vector<string>& readAll();
+    
+    // Get the number of names, 0 if the list is not completely read
+    unsigned getTotal();
+
+private:
+    // Read the next name, return false at the end of the file
+    bool readName();
+    
+    FILE* file;
+    char delimiter;
+    bool complete;
+    vector<string> names;
+};
+
+#endif /* SourceList_h */
@@ -933,6 +933,16 @@ class Analyzer(object):
         for row in cursor:
             postbranch_function_set.add((row[0], row[1]))
 
+        # The actions each post-branch function stands for, classified by clang-ehminer,
+        # a function standing for no action of a category has no action of it
+        action_mask = {}
+        try:
+            stmt = "SELECT distinct LogName, LogActionMask FROM branch_call WHERE LogActionMask IS NOT NULL"
+            for row in self.conn.execute(stmt):
+                action_mask[row[0]] = row[1]
+        except sqlite3.OperationalError:
+            pass
+
         # Create the table to store the result
         self.create_function_action()
 
@@ -990,6 +1000,8 @@ class Analyzer(object):
 
             parent = {}
             for i in range(len(action_name)):
+                if postbranch_function[0] in action_mask and not action_mask[postbranch_function[0]] & (1 << i):
+                    continue
                 root_functions = set()
                 root_functions.add(postbranch_function)
                 count = 0
@@ -1046,6 +1058,49 @@ class Analyzer(object):
 
 
 
+    # The same as get_function_action, but read the levels summarized by clang-ehminer -action-summary,
+    # the trace is rebuilt by following a callee one level lower down to the action function
+    def get_function_action_from_summary(self):
+        action_name = ['exit', 'output', 'free', 'delete', 'close', 'return', 'goto', 'break', 'continue']
+        level_column = ['ExitLevel', 'OutputLevel', 'FreeLevel', 'DeleteLevel', 'CloseLevel', 'ReturnLevel',
+                        'GotoLevel', 'BreakLevel', 'ContinueLevel']
+
+        # Create the table to store the result
+        self.create_function_action()
+
+        stmt = "SELECT distinct b.LogName, b.LogDefLoc, %s FROM branch_call b JOIN function_summary s \
+              ON s.FuncName = b.LogName AND s.FuncDefLoc = b.LogDefLoc" % ", ".join("s." + c for c in level_column)
+        rows = self.conn.execute(stmt).fetchall()
+        for row in rows:
+            for i in range(len(action_name)):
+                if row[i + 2] > 0:
+                    trace_str = self.get_summary_trace((row[0], row[1]), level_column[i], row[i + 2])
+                    trace_str = trace_str.replace('\'', '\'\'')
+                    self.insert_function_action((row[0], row[1]), action_name[i], trace_str, row[i + 2])
+
+    # Get the call chain of a summarized action, e.g., a->b->exit, a function at level n
+    # calls a function at level n - 1, and the function at level 1 is the action function
+    def get_summary_trace(self, function, level_column, level):
+        trace_str = function[0]
+        while level > 1:
+            level -= 1
+            stmt = "SELECT c.CallName, c.CallDefLoc FROM call_graph c JOIN function_summary s \
+                  ON s.FuncName = c.CallName AND s.FuncDefLoc = c.CallDefLoc \
+                  WHERE c.FuncName = '%s' AND c.FuncDefLoc = '%s' AND s.%s = %d \
+                  ORDER BY c.CallName, c.CallDefLoc LIMIT 1" % (function[0], function[1], level_column, level)
+            row = self.conn.execute(stmt).fetchone()
+            if row is None:
+                break
+            function = (row[0], row[1])
+            trace_str = trace_str + '->' + function[0]
+        return trace_str
+
+    def has_function_summary(self):
+        stmt = "SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'function_summary'"
+        if self.conn.execute(stmt).fetchone()[0] == 0:
+            return 0
+        return 1 if self.conn.execute("SELECT count(*) FROM function_summary").fetchone()[0] > 0 else 0
+
     def create_function_action(self):
         stmt = "DROP TABLE IF EXISTS function_action"
         self.conn.execute(stmt)
@@ -42,7 +42,11 @@ analyzer.set_skip_functions(['strcmp', 'strlen', 'strncmp', 'memcmp', 'strcasecm
 # Analyze the similarity of post-branch functions
 # Store the result to table function_callee of the database we specified before
 #analyzer.postbranch_function_similarity()
-analyzer.get_function_action()
+# The actions summarized by clang-ehminer -action-summary are read instead of walking the call graph
+if analyzer.has_function_summary():
+    analyzer.get_function_action_from_summary()
+else:
+    analyzer.get_function_action()
 
 # Analyze the equivalence of branch conditions for each target function
 # Store the result to column ExprSetID, table condition_equivalence
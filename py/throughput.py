@@ -0,0 +1,260 @@
+from __future__ import print_function
+import getopt
+import json
+import os
+import shlex
+import shutil
+import sqlite3
+import subprocess
+import sys
+import tarfile
+import tempfile
+import time
+
+
+# Show help message
+def usage():
+    print("""Usage: throughput.py [options]
+
+End-to-end throughput benchmark of clang-ehminer -find-branch-call on the
+projects bundled in the test directory, i.e., test/<domain>/*.tar.
+
+  -e <path>     the clang-ehminer binary (default is clang-ehminer in PATH)
+  -t <dir>      the test directory with test.conf (default is ../test)
+  -w <dir>      the working directory, the tarballs are extracted here
+                (default is a temporary directory, removed at exit)
+  -n <number>   the number of timed runs, the median is reported (default is 3)
+  -j <number>   the number of worker processes of clang-ehminer (default is 1)
+  -a <args>     more arguments of clang-ehminer, e.g., -a "-raw-source-text"
+  -o <file>     write the result as JSON to the file (default is stdout)
+  -b <file>     compare the result with the baseline in the file, fail if
+                the file doesn't exist
+  -r <percent>  the regression threshold in percent (default is 10)
+  -u            write the result to the baseline file instead of comparing
+""")
+
+
+# Extract the tarballs of each domain, the projects are in test/<domain>/*.tar
+def extract_projects(test_dir, work_dir):
+    for domain in sorted(os.listdir(test_dir)):
+        domain_dir = os.path.join(test_dir, domain)
+        if not os.path.isdir(domain_dir):
+            continue
+        for name in sorted(os.listdir(domain_dir)):
+            if ".tar" not in name:
+                continue
+            tar = tarfile.open(os.path.join(domain_dir, name))
+            tar.extractall(os.path.join(work_dir, domain))
+            tar.close()
+
+
+# Find the compiler in a command, skipping wrappers such as libtool
+def find_compiler(args):
+    for i in range(len(args)):
+        name = os.path.basename(args[i])
+        if name in ("cc", "c++", "gcc", "g++", "clang", "clang++") or name.endswith("-gcc"):
+            return i
+    return -1
+
+
+# Generate compile_commands.json from a dry run of make, so nothing is built or downloaded
+def generate_compile_commands(work_dir):
+    commands = []
+    for root, dirs, files in os.walk(work_dir):
+        dirs.sort()
+        if "Makefile" not in files:
+            continue
+        # The sub-makes are reached by the top-level Makefile
+        if os.path.exists(os.path.join(os.path.dirname(root), "Makefile")) and root != work_dir:
+            continue
+
+        output = subprocess.check_output(["make", "-n", "-B", "-w"], cwd=root, stderr=open(os.devnull, "w"))
+        directory = root
+        for line in output.decode("utf-8", "replace").splitlines():
+            if "Entering directory" in line:
+                directory = line.split("'")[1] if "'" in line else line.split("`")[1].rstrip("'")
+                continue
+            if " -c " not in line:
+                continue
+            for command in line.split("&&"):
+                try:
+                    args = shlex.split(command)
+                except ValueError:
+                    continue
+                if args and args[0] == "cd" and len(args) > 1:
+                    directory = os.path.join(directory, args[1])
+                    continue
+                begin = find_compiler(args)
+                if begin < 0 or "-c" not in args:
+                    continue
+                args = args[begin:]
+                sources = [arg for arg in args if arg.endswith((".c", ".cc", ".cpp"))]
+                if not sources:
+                    continue
+                commands.append({"directory": directory,
+                                 "arguments": args,
+                                 "file": os.path.normpath(os.path.join(directory, sources[-1]))})
+
+    with open(os.path.join(work_dir, "compile_commands.json"), "w") as f:
+        json.dump(commands, f, indent=1)
+    return sorted(set(command["file"] for command in commands))
+
+
+# Count the rows of each table in the database
+def count_rows(database_file):
+    conn = sqlite3.connect(database_file)
+    tables = [row[0] for row in conn.execute("SELECT name FROM sqlite_master WHERE type='table' AND name NOT LIKE 'sqlite_%'")]
+    rows = {}
+    for table in sorted(tables):
+        rows[table] = conn.execute("SELECT count(*) FROM " + table).fetchone()[0]
+    conn.close()
+    return rows
+
+
+# Run clang-ehminer once on a fresh database, return the wall time and the peak RSS in KB
+def run_tool(tool, work_dir, conf_file, jobs, extra_args, database_file):
+    if os.path.exists(database_file):
+        os.remove(database_file)
+    command = [tool, "-p", work_dir, "-find-branch-call",
+               "-config-file=" + conf_file,
+               "-database-file=" + database_file,
+               "-source-file=" + os.path.join(work_dir, "all_files.in"),
+               "-j", str(jobs)] + extra_args + [os.path.join(work_dir, "empty.c")]
+
+    start = time.time()
+    process = subprocess.Popen(command, cwd=work_dir, stdout=open(os.devnull, "w"), stderr=open(os.devnull, "w"))
+    # The usage of the tool and its -j workers, which it waits for
+    pid, status, usage = os.wait4(process.pid, 0)
+    wall_time = time.time() - start
+    if status != 0:
+        print("clang-ehminer failed: " + " ".join(command), file=sys.stderr)
+        sys.exit(2)
+    return wall_time, usage.ru_maxrss
+
+
+# Compare the result with the baseline, return the regressions
+def compare(result, baseline, threshold):
+    regressions = []
+    # Larger is better for the rates, and smaller is better for the sizes
+    for metric, larger_better in (("files_per_sec", True), ("rows_per_sec", True),
+                                  ("peak_rss_kb", False), ("db_bytes", False)):
+        if metric not in baseline or not baseline[metric]:
+            continue
+        change = (result[metric] - baseline[metric]) * 100.0 / baseline[metric]
+        regressed = change < -threshold if larger_better else change > threshold
+        print("%-14s %14.1f %14.1f %+8.1f%%%s" % (metric, baseline[metric], result[metric], change,
+                                                 "  REGRESSION" if regressed else ""), file=sys.stderr)
+        if regressed:
+            regressions.append(metric)
+    if result["rows"] != baseline.get("rows", result["rows"]):
+        print("Note: the rows changed from %d to %d" % (baseline["rows"], result["rows"]), file=sys.stderr)
+    return regressions
+
+
+# Default command line options
+tool = "clang-ehminer"
+test_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "test")
+work_dir = ""
+run_num = 3
+jobs = 1
+extra_args = []
+output_file = ""
+baseline_file = ""
+threshold = 10.0
+update_baseline = 0
+
+# Deal with command line options
+opts, args = getopt.getopt(sys.argv[1:], "he:t:w:n:j:a:o:b:r:u")
+for op, value in opts:
+    if op == "-e":
+        tool = value
+    elif op == "-t":
+        test_dir = value
+    elif op == "-w":
+        work_dir = value
+    elif op == "-n":
+        run_num = max(1, int(value))
+    elif op == "-j":
+        jobs = int(value)
+    elif op == "-a":
+        extra_args = shlex.split(value)
+    elif op == "-o":
+        output_file = value
+    elif op == "-b":
+        baseline_file = value
+    elif op == "-r":
+        threshold = float(value)
+    elif op == "-u":
+        update_baseline = 1
+    elif op == "-h":
+        usage()
+        sys.exit(0)
+
+test_dir = os.path.abspath(test_dir)
+remove_work_dir = not work_dir
+work_dir = os.path.abspath(work_dir) if work_dir else tempfile.mkdtemp(prefix="ehminer-throughput-")
+if not os.path.isdir(work_dir):
+    os.makedirs(work_dir)
+
+try:
+    # Prepare the projects, the compile database and the list of source files
+    extract_projects(test_dir, work_dir)
+    source_files = generate_compile_commands(work_dir)
+    if not source_files:
+        print("No source file found in " + test_dir, file=sys.stderr)
+        sys.exit(2)
+    with open(os.path.join(work_dir, "all_files.in"), "w") as f:
+        f.write("\n".join(source_files) + "\n")
+    open(os.path.join(work_dir, "empty.c"), "w").close()
+
+    # Time the runs, each on a fresh database
+    database_file = os.path.join(work_dir, "throughput.db")
+    runs = []
+    for i in range(run_num):
+        wall_time, peak_rss = run_tool(tool, work_dir, os.path.join(test_dir, "test.conf"), jobs, extra_args, database_file)
+        runs.append({"wall_time": wall_time, "peak_rss_kb": peak_rss})
+        print("Run %d/%d: %.3f s" % (i + 1, run_num, wall_time), file=sys.stderr)
+
+    # Report the median run, the database is the same for each run
+    wall_time = sorted(run["wall_time"] for run in runs)[len(runs) // 2]
+    tables = count_rows(database_file)
+    rows = sum(tables.values())
+    result = {
+        "files": len(source_files),
+        "rows": rows,
+        "tables": tables,
+        "wall_time": wall_time,
+        "files_per_sec": len(source_files) / wall_time,
+        "rows_per_sec": rows / wall_time,
+        "db_bytes": os.path.getsize(database_file),
+        "peak_rss_kb": max(run["peak_rss_kb"] for run in runs),
+        "jobs": jobs,
+        "runs": runs,
+    }
+
+    output = json.dumps(result, indent=2, sort_keys=True)
+    if output_file:
+        with open(output_file, "w") as f:
+            f.write(output + "\n")
+    else:
+        print(output)
+
+    # Compare with the baseline, or replace it
+    if baseline_file and update_baseline:
+        with open(baseline_file, "w") as f:
+            f.write(output + "\n")
+        print("Baseline written to " + baseline_file, file=sys.stderr)
+    elif baseline_file:
+        # A missing baseline fails, otherwise the regression check passes without checking anything
+        if not os.path.exists(baseline_file):
+            print("No baseline in %s, run with -u to record one" % baseline_file, file=sys.stderr)
+            sys.exit(2)
+        with open(baseline_file) as f:
+            baseline = json.load(f)
+        regressions = compare(result, baseline, threshold)
+        if regressions:
+            print("Regressed by more than %.1f%%: %s" % (threshold, ", ".join(regressions)), file=sys.stderr)
+            sys.exit(1)
+finally:
+    if remove_work_dir:
+        shutil.rmtree(work_dir, ignore_errors=True)